@@ -0,0 +1,23 @@
+# Turns a SPIR-V binary into a header with an aligned constexpr uint32_t array.
+# Usage: cmake -DINPUT=<file.spv> -DOUTPUT=<file.h> -DNAME=<identifier> -P EmbedSpirv.cmake
+
+file(READ ${INPUT} SPIRV_HEX HEX)
+
+string(LENGTH "${SPIRV_HEX}" SPIRV_HEX_LENGTH)
+math(EXPR SPIRV_REMAINDER "${SPIRV_HEX_LENGTH} % 8")
+if (NOT SPIRV_REMAINDER EQUAL 0)
+    message(FATAL_ERROR "${INPUT} is not a whole number of 32-bit words")
+endif ()
+
+# SPIR-V words are little endian, so every group of four bytes is reversed into one literal
+string(REGEX REPLACE "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])" "        0x\\4\\3\\2\\1u,\n" SPIRV_WORDS "${SPIRV_HEX}")
+
+file(WRITE ${OUTPUT}
+        "// generated from ${INPUT}, do not edit\n"
+        "#pragma once\n"
+        "#include <cstdint>\n\n"
+        "namespace Coreful::renderer::vulkan::shaders {\n"
+        "    alignas(4) inline constexpr uint32_t ${NAME}[] = {\n${SPIRV_WORDS}"
+        "    };\n"
+        "}\n"
+)
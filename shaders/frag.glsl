@@ -1,6 +1,17 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragTextureIndex;
+
+//the texture table, every texture a frame uses at once
+layout(set = 0, binding = 0) uniform sampler textureSampler;
+layout(set = 0, binding = 1) uniform texture2D textures[];
+
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = vec4(1.0, 0.0, 0.0, 1.0); // red
+    //neighbouring quads can use different textures, so the index isn't uniform across a draw
+    outColor = fragColor * texture(sampler2D(textures[nonuniformEXT(fragTextureIndex)], textureSampler), fragTexCoord);
 }
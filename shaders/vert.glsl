@@ -1,10 +1,36 @@
 #version 450
-vec2 positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
+
+//per instance: x, y, width, height in pixels, a color and a texture table index
+layout(location = 0) in vec4 inRect;
+layout(location = 1) in vec4 inColor;
+layout(location = 2) in uint inTextureIndex;
+
+layout(push_constant) uniform PushConstants {
+    vec2 screenSize;
+} pc;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragTextureIndex;
+
+//two triangles covering the unit square
+vec2 corners[6] = vec2[](
+    vec2(0.0, 0.0),
+    vec2(1.0, 0.0),
+    vec2(1.0, 1.0),
+    vec2(0.0, 0.0),
+    vec2(1.0, 1.0),
+    vec2(0.0, 1.0)
 );
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
+    vec2 pixel = inRect.xy + corners[gl_VertexIndex] * inRect.zw;
+
+    //the viewport is flipped so +y is up, pixel y = 0 is the top edge
+    vec2 ndc = pixel / pc.screenSize * 2.0 - 1.0;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+
+    fragColor = inColor;
+    fragTexCoord = corners[gl_VertexIndex];//the whole texture over the quad
+    fragTextureIndex = inTextureIndex;
 }
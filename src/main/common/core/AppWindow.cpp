@@ -8,6 +8,7 @@
 #endif
 
 #include "ui/Drawable.h"
+#include "util/Profiler.h"
 
 namespace Coreful {
     // ReSharper disable once CppParameterMayBeConst
@@ -34,10 +35,36 @@ namespace Coreful {
         drawable.draw(*this);
     }
 
+    void AppWindow::drawQuad(const QuadInstance& quad) const {
+        if (m_recordedQuads) {
+            m_recordedQuads->push_back(quad);
+        } else if (m_renderer) {
+            m_renderer->submitQuad(quad);
+        }
+    }
+
+    void AppWindow::addDamage(const DamageRect& rect) const {
+        if (m_recordedDamage) {
+            m_recordedDamage->add(rect);
+        } else if (m_renderer) {
+            m_renderer->addDamage(rect);
+        }
+    }
+
     void AppWindow::processMessages() const {
+        PROFILE_SCOPE("process messages");
         m_platformWindow->processMessages();
     }
 
+    void AppWindow::waitEvents(const std::chrono::nanoseconds timeout) const {
+        PROFILE_SCOPE("wait events");
+        m_platformWindow->waitEvents(timeout);
+    }
+
+    size_t AppWindow::pollEvents(const std::span<Event> events) const {
+        return m_platformWindow->getEventDispatcher().pollEvents(events);
+    }
+
     bool AppWindow::isRunning() const {
         return m_platformWindow->isRunning();
     }
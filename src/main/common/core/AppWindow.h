@@ -1,9 +1,11 @@
 #pragma once
 
 #include <memory>
+#include <span>
 
 #include "math/Vector2.h"
 #include "platform/PlatformWindow.h"
+#include "renderer/Renderer.h"
 #include "ui/DrawTarget.h"
 
 namespace Coreful {
@@ -15,14 +17,38 @@ namespace Coreful {
 
         void draw(ui::Drawable& drawable) const override;
 
+        void drawQuad(const QuadInstance& quad) const override;
+
+        void addDamage(const DamageRect& rect) const override;
+
+        //quads drawn into this window are submitted to renderer
+        void setRenderer(Renderer* renderer) {m_renderer = renderer;}
+
+        //while set, drawn quads and damage are recorded here instead of going to the renderer
+        void recordQuads(std::vector<QuadInstance>* quads, DamageRegion* damage) {
+            m_recordedQuads = quads;
+            m_recordedDamage = damage;
+        }
+
         std::unique_ptr<PlatformWindow> m_platformWindow;
 
         void processMessages() const;
 
+        //sleeps until the window has something to process, see PlatformWindow::waitEvents
+        void waitEvents(std::chrono::nanoseconds timeout = PlatformWindow::WAIT_FOREVER) const;
+
+        //events gathered by processMessages(), returns how many were written
+        size_t pollEvents(std::span<Event> events) const;
+
         [[nodiscard]] bool isRunning() const;
 
         [[nodiscard]] PlatformWindow& get() const;
 
+    private:
+
+        Renderer* m_renderer = nullptr;
+        std::vector<QuadInstance>* m_recordedQuads = nullptr;
+        DamageRegion* m_recordedDamage = nullptr;
 
     };
 }
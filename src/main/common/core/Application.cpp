@@ -1,10 +1,34 @@
 
 #include "Application.h"
 
+#include <array>
+#include <fstream>
+#include <thread>
+
 #include "renderer/vulkan/VulkanRenderer.h"
+#include "util/Logger.h"
+#include "util/Profiler.h"
 
 namespace Coreful {
-    Application::Application()= default;
+
+    namespace {
+        //cleans the renderer up however run() is left, a frame that throws must not leak the device or lose the pipeline cache
+        struct RendererCleanup {
+            Renderer* renderer;
+
+            ~RendererCleanup() {
+                try {
+                    renderer->cleanup();
+                } catch (const std::exception& e) {
+                    log(Logger::LogType::Error, "Renderer cleanup failed: ", e.what());
+                }
+            }
+        };
+    }
+
+    Application::Application() {
+        m_jobSystem.init();
+    }
 
     Application::~Application() = default;
 
@@ -15,7 +39,7 @@ namespace Coreful {
     void Application::createRenderer(const RendererType rendererType) {
 
         if (rendererType == RendererType::VULKAN) {
-            m_renderer = std::make_unique<renderer::vulkan::VulkanRenderer>();
+            m_renderer = std::make_unique<renderer::vulkan::VulkanRenderer>(&m_jobSystem);
         }else {
             throw std::runtime_error("Renderer type not supported!");
         }
@@ -30,12 +54,226 @@ namespace Coreful {
             throw std::runtime_error("Renderer not created!");
         }
         m_renderer->init(m_appWindow->get());
+        m_appWindow->setRenderer(m_renderer.get());
+    }
+
+    void Application::initializeHeadlessRenderer(const math::Vector2u& targetSize) {
+        if (!m_renderer) {
+            throw std::runtime_error("Renderer not created!");
+        }
+        m_renderer->initHeadless(targetSize.x.raw(), targetSize.y.raw());
+        m_headlessSize = targetSize;
+    }
+
+    void Application::createUI() {
+        if (!m_appWindow) {
+            throw std::runtime_error("Application Window not created!");
+        }
+        m_appUI = std::make_unique<ui::AppUI>(m_appWindow.get());
+    }
+
+    void Application::run() {
+        m_renderer->setDamageTracking(m_damageTracking);
+
+        //destroyed once the render thread is joined, the job system is still alive then
+        const RendererCleanup rendererCleanup{m_renderer.get()};
+
+        if (m_threadingMode == ThreadingMode::RenderThread) {
+            runRenderThread();
+        } else {
+            runSingleThread();
+        }
     }
 
-    void Application::run() const {
+    void Application::runHeadless(const std::string& imagePath) {
+        const RendererCleanup rendererCleanup{m_renderer.get()};
+
+        m_renderer->beginFrame();
+        m_renderer->render();
+
+        std::vector<uint8_t> pixels;
+        if (!m_renderer->readPixels(pixels)) {
+            throw std::runtime_error("Headless renderer not initialized!");
+        }
+
+        std::ofstream file(imagePath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open " + imagePath);
+        }
+
+        //ppm has no alpha, the rgba pixels lose every fourth byte
+        const uint32_t width = m_headlessSize.x.raw(), height = m_headlessSize.y.raw();
+        file << "P6\n" << width << ' ' << height << "\n255\n";
+        for (size_t i = 0; i + 3 < pixels.size(); i += 4) {
+            file.write(reinterpret_cast<const char*>(&pixels[i]), 3);
+        }
+
+        log(Logger::LogType::Info, "Headless frame written to ", imagePath);
+    }
+
+    void Application::runSingleThread() const {
+        PROFILE_THREAD_NAME("main");
+
         while (m_appWindow->isRunning()) {
+            PROFILE_SCOPE("frame");
+
             m_appWindow->processMessages();
+
+            std::array<Event, 64> events;
+            const size_t eventCount = m_appWindow->pollEvents(events);
+            for (size_t i = 0; i < eventCount; i++) handleEvent(events[i]);
+
+            //nothing to draw, sleep until the window changes instead of spinning on skipped frames
+            if (!m_appWindow->get().isVisible()) {
+                m_appWindow->waitEvents();
+                continue;
+            }
+
+            m_renderer->beginFrame();
+            if (m_appUI) {
+                PROFILE_SCOPE("ui draw");
+                m_appUI->draw();
+            }
+
             m_renderer->render();
+
+            //nothing changed, the next message is the earliest anything can
+            if (!m_renderer->needsRedraw()) m_appWindow->waitEvents();
+        }
+    }
+
+    void Application::runRenderThread() {
+        PROFILE_THREAD_NAME("main");
+
+        std::jthread renderThread([this](const std::stop_token& stop) {renderLoop(stop);});
+        std::array<Event, 64> events;
+        bool publishedHidden = false;
+        bool exposed = false;
+        uint32_t publishedWidth = 0, publishedHeight = 0;
+
+        while (m_appWindow->isRunning() && !m_renderThreadFailed.load(std::memory_order_acquire)) {
+            PROFILE_SCOPE("main frame");
+
+            m_appWindow->processMessages();
+
+            //the size and damage travel with the snapshot, so nothing here touches the renderer
+            size_t eventCount;
+            do {
+                eventCount = m_appWindow->pollEvents(events);
+                for (size_t i = 0; i < eventCount; i++) {
+                    if (events[i].type == EventType::WindowExposed) exposed = true;
+                }
+            } while (eventCount == events.size());
+
+            //one frame ahead is enough, the render thread wakes us once it has taken the snapshot
+            if (m_snapshots.hasUnread()) {
+                m_appWindow->waitEvents(SNAPSHOT_WAIT_TIMEOUT);
+                continue;
+            }
+
+            //the render thread already knows there is nothing to draw, only the window can change that
+            const bool visible = m_appWindow->get().isVisible();
+            if (!visible && publishedHidden) {
+                m_appWindow->waitEvents();
+                continue;
+            }
+            publishedHidden = !visible;
+
+            FrameSnapshot& snapshot = m_snapshots.back();
+            snapshot.quads.clear();
+            snapshot.damage.clear();
+            snapshot.width = visible ? m_appWindow->get().getWidth().raw() : 0;
+            snapshot.height = visible ? m_appWindow->get().getHeight().raw() : 0;
+
+            if (m_appUI && visible) {
+                PROFILE_SCOPE("ui draw");
+                m_appWindow->recordQuads(&snapshot.quads, &snapshot.damage);
+                m_appUI->draw();
+                m_appWindow->recordQuads(nullptr, nullptr);
+            }
+            if (exposed) snapshot.damage.markFull();
+
+            //an unchanged frame isn't worth handing over, sleep until a message might change it
+            const bool resized = snapshot.width != publishedWidth || snapshot.height != publishedHeight;
+            if (m_damageTracking && !resized && snapshot.damage.isEmpty()) {
+                m_appWindow->waitEvents();
+                continue;
+            }
+
+            m_snapshots.publish();
+            exposed = false;
+            publishedWidth = snapshot.width;
+            publishedHeight = snapshot.height;
+        }
+
+        renderThread.request_stop();
+        m_snapshots.publish();//in case it is waiting for one
+        renderThread.join();
+
+        if (m_renderThreadError) std::rethrow_exception(m_renderThreadError);
+    }
+
+    void Application::renderLoop(const std::stop_token& stop) {
+        PROFILE_THREAD_NAME("render");
+
+        try {
+            uint32_t width = 0, height = 0;
+
+            while (!stop.stop_requested()) {
+                if (m_snapshots.update()) {
+                    //the publish that wakes us for shutdown comes after request_stop(), it is not a frame to draw
+                    //and nothing is published after it, so waiting again would never return
+                    if (stop.stop_requested()) break;
+
+                    m_appWindow->get().wake();
+
+                    const DamageRegion& damage = m_snapshots.front().damage;
+                    if (damage.isFull()) m_renderer->invalidate();
+                    for (const DamageRect& rect : damage.getRects()) m_renderer->addDamage(rect);
+                }
+                const FrameSnapshot& snapshot = m_snapshots.front();
+
+                //nothing published yet, or minimized, there is no swapchain to draw into
+                if (snapshot.width == 0 || snapshot.height == 0) {
+                    m_snapshots.waitForPublish();
+                    continue;
+                }
+
+                if (snapshot.width != width || snapshot.height != height) {
+                    width = snapshot.width;
+                    height = snapshot.height;
+                    m_renderer->resize(width, height);
+                }
+
+                //with damage tracking the same snapshot is only drawn again once something changed
+                if (!m_renderer->needsRedraw()) {
+                    m_snapshots.waitForPublish();
+                    continue;
+                }
+
+                PROFILE_SCOPE("render frame");
+                m_renderer->beginFrame();
+                for (const QuadInstance& quad : snapshot.quads) m_renderer->submitQuad(quad);
+                m_renderer->render();
+            }
+        } catch (const std::exception& e) {
+            log(Logger::LogType::Error, "Render thread stopped: ", e.what());
+            m_renderThreadError = std::current_exception();
+            m_renderThreadFailed.store(true, std::memory_order_release);
+            m_appWindow->get().wake();//the main thread may be asleep waiting for window messages
+        }
+    }
+
+    void Application::handleEvent(const Event& event) const {
+        switch (event.type) {
+            case EventType::WindowResized:
+                m_renderer->resize(static_cast<uint32_t>(event.context.width), static_cast<uint32_t>(event.context.height));
+                break;
+            case EventType::WindowExposed:
+                m_renderer->invalidate();
+                break;
+            default:
+                break;
         }
     }
 }
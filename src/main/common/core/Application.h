@@ -1,12 +1,26 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <exception>
 #include <memory>
+#include <stop_token>
+#include <vector>
 
 #include "AppWindow.h"
+#include "JobSystem.h"
+#include "TripleBuffer.h"
 #include "math/Vector2.h"
 #include "renderer/Renderer.h"
+#include "ui/AppUI.h"
 
 
 namespace Coreful {
+
+    enum class ThreadingMode {
+        SingleThread,//events and frames alternate on the thread calling run()
+        RenderThread//run() handles the window and builds frames, a second thread owns the renderer and draws them
+    };
+
     class Application {
 
     public:
@@ -19,11 +33,51 @@ namespace Coreful {
 
         void initializeRenderer() const;
 
+        void initializeHeadlessRenderer(const math::Vector2u& targetSize);
+
+        void createUI();
+
+        //has to be chosen before run()
+        void setThreadingMode(const ThreadingMode mode) {m_threadingMode = mode;}
+
+        //has to be chosen before run(), only changed parts of the ui are redrawn and unchanged frames are skipped
+        void setDamageTracking(const bool enabled) {m_damageTracking = enabled;}
+
+        JobSystem m_jobSystem;//first, so it outlives everything that might still have jobs in flight
         std::unique_ptr<AppWindow> m_appWindow;
         std::unique_ptr<Renderer> m_renderer;
+        std::unique_ptr<ui::AppUI> m_appUI;
+
+
+        void run();
+
+        //instead of run() after initializeHeadlessRenderer(), renders one frame and writes it to imagePath as a binary ppm
+        void runHeadless(const std::string& imagePath);
+
+    private:
+
+        //everything the render thread needs for one frame, built on the main thread
+        struct FrameSnapshot {
+            std::vector<QuadInstance> quads;
+            DamageRegion damage;
+            uint32_t width = 0, height = 0;
+        };
+
+        //only a fallback, the render thread wakes the main thread when it takes a snapshot
+        constexpr static std::chrono::milliseconds SNAPSHOT_WAIT_TIMEOUT{100};
+
+        ThreadingMode m_threadingMode = ThreadingMode::SingleThread;
+        bool m_damageTracking = false;
+        math::Vector2u m_headlessSize{0u, 0u};
+        TripleBuffer<FrameSnapshot> m_snapshots;
+        std::atomic<bool> m_renderThreadFailed = false;
+        std::exception_ptr m_renderThreadError;
 
+        void runSingleThread() const;
+        void runRenderThread();
+        void renderLoop(const std::stop_token& stop);
 
-        void run() const;
+        void handleEvent(const Event& event) const;
 
     };
 }
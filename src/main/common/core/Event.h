@@ -4,10 +4,12 @@
 namespace Coreful {
 
     enum class EventType {
-        None,
+        Empty,//not "None", Xlib defines that as a macro
         WindowClosed,
         WindowResized,
+        WindowExposed,//the window's contents were lost and have to be drawn again
         MouseButtonPressed,
+        MouseMoved,
     };
 
     struct EventContext {
@@ -16,9 +18,11 @@ namespace Coreful {
     };
 
     struct Event {
-        EventType type = EventType::None;
+        EventType type = EventType::Empty;
         EventContext context;
 
+        Event() = default;
+
         Event(const EventType type, const int width, const int height, const int mouseX, const int mouseY) {
             this->type = type;
             this->context.width = width;
@@ -1,26 +1,160 @@
 #pragma once
-#include <queue>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
 
 #include "Event.h"
 
 namespace Coreful {
+
+    //fixed capacity ring, any thread may push and one thread polls, nothing allocates after construction
+    //when the ring is full resizes and mouse motion collapse into their latest value and a close is never lost
     class EventDispatcher {
 
     public:
+
+        constexpr static size_t CAPACITY = 256;//must be a power of two
+
+        EventDispatcher() {
+            for (size_t i = 0; i < CAPACITY; i++) m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        EventDispatcher(const EventDispatcher&) = delete;
+        EventDispatcher& operator=(const EventDispatcher&) = delete;
+
         void pushEvent(const Event& event) {
-            m_events.push(event);
+            if (tryPush(event)) {
+                //a value coalesced during an earlier overflow is older than this one and would otherwise be delivered after it
+                if (event.type == EventType::WindowResized) m_latestResize.discard();
+                else if (event.type == EventType::MouseMoved) m_latestMotion.discard();
+                return;
+            }
+
+            switch (event.type) {
+                case EventType::WindowClosed:
+                    m_closePending.store(true, std::memory_order_release);
+                    break;
+                case EventType::WindowResized:
+                    m_latestResize.store(event.context.width, event.context.height);
+                    break;
+                case EventType::MouseMoved:
+                    m_latestMotion.store(event.context.mouseX, event.context.mouseY);
+                    break;
+                default:
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    break;
+            }
+        }
+
+        //copies up to events.size() events in push order, returns how many, consumer thread only
+        size_t pollEvents(const std::span<Event> events) {
+            size_t count = 0;
+
+            while (count < events.size()) {
+                Slot& slot = m_slots[m_tail & (CAPACITY - 1)];
+                if (slot.sequence.load(std::memory_order_acquire) != m_tail + 1) break;
+
+                events[count++] = slot.event;
+                slot.sequence.store(m_tail + CAPACITY, std::memory_order_release);
+                m_tail++;
+            }
+
+            //overflowed events came after everything in the ring, so they only go out once it is drained
+            int x, y;
+            if (count < events.size() && !hasQueued() && m_latestResize.take(x, y)) {
+                events[count++] = Event(EventType::WindowResized, x, y, 0, 0);
+            }
+            if (count < events.size() && !hasQueued() && m_latestMotion.take(x, y)) {
+                events[count++] = Event(EventType::MouseMoved, 0, 0, x, y);
+            }
+            if (count < events.size() && !hasQueued() && m_closePending.exchange(false, std::memory_order_acquire)) {
+                events[count++] = Event(EventType::WindowClosed);
+            }
+
+            return count;
         }
 
         bool pollEvent(Event& event) {
-            if (m_events.empty()) return false;
-            event = m_events.front();
-            m_events.pop();
-            return true;
+            return pollEvents(std::span(&event, 1)) == 1;
+        }
+
+        //events that could neither be queued nor coalesced since the last call
+        size_t takeDroppedCount() {
+            return m_dropped.exchange(0, std::memory_order_relaxed);
         }
 
     private:
-        std::queue<Event> m_events;
-    };
-}
 
+        static_assert((CAPACITY & (CAPACITY - 1)) == 0, "EventDispatcher::CAPACITY must be a power of two");
+        static_assert(std::is_trivially_copyable_v<Event>, "Events are copied in and out of the ring");
 
+        struct alignas(64) Slot {
+            std::atomic<size_t> sequence;
+            Event event;
+        };
+
+        Slot m_slots[CAPACITY];
+
+        //producers and the consumer each get their own cache line
+        alignas(64) std::atomic<size_t> m_head{0};
+        alignas(64) size_t m_tail = 0;
+
+        //one pair of ints where later stores overwrite earlier ones
+        struct Latest {
+            std::atomic<uint64_t> value{0};
+            std::atomic<bool> pending{false};
+
+            void store(const int x, const int y) {
+                value.store(static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32 | static_cast<uint32_t>(y), std::memory_order_relaxed);
+                pending.store(true, std::memory_order_release);
+            }
+
+            void discard() {
+                pending.store(false, std::memory_order_relaxed);
+            }
+
+            bool take(int& x, int& y) {
+                if (!pending.exchange(false, std::memory_order_acquire)) return false;
+                const uint64_t packed = value.load(std::memory_order_relaxed);
+                x = static_cast<int>(static_cast<uint32_t>(packed >> 32));
+                y = static_cast<int>(static_cast<uint32_t>(packed));
+                return true;
+            }
+        };
+
+        alignas(64) Latest m_latestResize;
+        Latest m_latestMotion;
+        std::atomic<bool> m_closePending{false};
+        std::atomic<size_t> m_dropped{0};
+
+        bool tryPush(const Event& event) {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            Slot* slot;
+
+            for (;;) {
+                slot = &m_slots[head & (CAPACITY - 1)];
+                const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(head);
+
+                if (diff == 0) {
+                    if (m_head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed)) break;
+                } else if (diff < 0) {
+                    return false;//full
+                } else {
+                    head = m_head.load(std::memory_order_relaxed);
+                }
+            }
+
+            slot->event = event;
+            slot->sequence.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        [[nodiscard]] bool hasQueued() const {
+            return m_slots[m_tail & (CAPACITY - 1)].sequence.load(std::memory_order_acquire) == m_tail + 1;
+        }
+
+    };
+}
@@ -0,0 +1,241 @@
+
+#include "JobSystem.h"
+
+#include <exception>
+#include <utility>
+
+#include "util/Logger.h"
+#include "util/Profiler.h"
+
+namespace Coreful {
+
+    namespace {
+        //the pool the calling thread works for, null on threads outside any pool
+        thread_local JobSystem* t_jobSystem = nullptr;
+        thread_local uint32_t t_workerIndex = 0;
+
+        constexpr int SPIN_COUNT = 64;//tries before an idle worker sleeps
+    }
+
+    bool JobSystem::WorkStealingDeque::push(Job* job) {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_top.load(std::memory_order_acquire);
+        if (bottom - top >= static_cast<int64_t>(DEQUE_CAPACITY)) return false;
+
+        m_jobs[bottom & (DEQUE_CAPACITY - 1)].store(job, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    JobSystem::Job* JobSystem::WorkStealingDeque::pop() {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Job* job = m_jobs[bottom & (DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (top == bottom) {
+            //last job, race the thieves for it
+            if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) job = nullptr;
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    JobSystem::Job* JobSystem::WorkStealingDeque::steal() {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+        if (top >= bottom) return nullptr;
+
+        Job* job = m_jobs[top & (DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+        return job;
+    }
+
+    bool JobSystem::WorkStealingDeque::empty() const {
+        return m_bottom.load(std::memory_order_acquire) <= m_top.load(std::memory_order_acquire);
+    }
+
+    void JobSystem::init(uint32_t workerCount) {
+        if (!m_workers.empty()) return;
+
+        if (workerCount == 0) workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+        m_stopping.store(false, std::memory_order_relaxed);
+        for (uint32_t i = 0; i < workerCount; i++) m_workers.push_back(std::make_unique<Worker>());
+        for (uint32_t i = 0; i < workerCount; i++) m_workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+
+        LOG_DEBUGF("Job System Created! ({} workers)", workerCount);
+    }
+
+    void JobSystem::shutdown() {
+        if (m_workers.empty()) return;
+
+        m_stopping.store(true, std::memory_order_release);
+        m_wake.fetch_add(1, std::memory_order_release);
+        m_wake.notify_all();
+
+        for (const auto& worker : m_workers) worker->thread.join();
+        m_workers.clear();
+    }
+
+    void JobSystem::run(JobCounter& counter, std::function<void()> task) {
+        counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+
+        if (m_workers.empty()) {
+            //not initialized, nobody else could run it
+            invoke(counter, task);
+            counter.m_pending.fetch_sub(1, std::memory_order_release);
+            return;
+        }
+
+        auto* job = new Job{std::move(task), &counter};
+
+        if (t_jobSystem == this) {
+            //a full deque runs the job right away instead of growing
+            if (!m_workers[t_workerIndex]->deque.push(job)) {
+                execute(job);
+                return;
+            }
+        } else {
+            std::lock_guard lock(m_sharedMutex);
+            m_sharedJobs.push_back(job);
+            m_sharedCount.fetch_add(1, std::memory_order_release);
+        }
+
+        wakeWorker();
+    }
+
+    void JobSystem::wait(JobCounter& counter) {
+        int spins = 0;
+
+        while (!counter.isDone()) {
+            if (Job* job = findJob()) {
+                execute(job);
+                spins = 0;
+                continue;
+            }
+
+            //whatever is left is already running on another thread
+            if (++spins < SPIN_COUNT) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            const uint32_t wake = m_counterWake.load(std::memory_order_acquire);
+            if (!counter.isDone()) m_counterWake.wait(wake, std::memory_order_acquire);
+        }
+
+        //isDone() acquired every job's decrement, so the error is visible here
+        if (counter.m_error) {
+            const std::exception_ptr error = std::exchange(counter.m_error, nullptr);
+            counter.m_failed.store(false, std::memory_order_relaxed);
+            std::rethrow_exception(error);
+        }
+    }
+
+    void JobSystem::workerLoop(const uint32_t index) {
+        t_jobSystem = this;
+        t_workerIndex = index;
+        PROFILE_THREAD_NAME("job worker");
+
+        int spins = 0;
+
+        while (!m_stopping.load(std::memory_order_acquire)) {
+            if (Job* job = findJob()) {
+                execute(job);
+                spins = 0;
+                continue;
+            }
+
+            if (++spins < SPIN_COUNT) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            //sleep until run() pushes something, checked again after announcing so a push can't slip by
+            const uint32_t wake = m_wake.load(std::memory_order_acquire);
+            m_sleeping.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (!hasWork() && !m_stopping.load(std::memory_order_acquire)) m_wake.wait(wake, std::memory_order_acquire);
+            m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+            spins = 0;
+        }
+    }
+
+    JobSystem::Job* JobSystem::findJob() {
+        const bool isWorker = t_jobSystem == this;
+
+        if (isWorker) {
+            if (Job* job = m_workers[t_workerIndex]->deque.pop()) return job;
+        }
+
+        if (m_sharedCount.load(std::memory_order_acquire) > 0) {
+            std::lock_guard lock(m_sharedMutex);
+            if (!m_sharedJobs.empty()) {
+                Job* job = m_sharedJobs.front();
+                m_sharedJobs.pop_front();
+                m_sharedCount.fetch_sub(1, std::memory_order_relaxed);
+                return job;
+            }
+        }
+
+        //start at a different victim on every thread so thieves don't all hit the same deque
+        const size_t count = m_workers.size();
+        const size_t start = isWorker ? t_workerIndex + 1 : 0;
+        for (size_t i = 0; i < count; i++) {
+            const size_t victim = (start + i) % count;
+            if (isWorker && victim == t_workerIndex) continue;
+            if (Job* job = m_workers[victim]->deque.steal()) return job;
+        }
+
+        return nullptr;
+    }
+
+    void JobSystem::execute(Job* job) {
+        invoke(*job->counter, job->task);
+
+        JobCounter* counter = job->counter;
+        delete job;
+
+        if (counter->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            m_counterWake.fetch_add(1, std::memory_order_release);
+            m_counterWake.notify_all();
+        }
+    }
+
+    void JobSystem::invoke(JobCounter& counter, const std::function<void()>& task) {
+        try {
+            task();
+        } catch (...) {
+            //a worker has nobody to throw to, the first failure goes to whoever waits on the counter
+            if (!counter.m_failed.exchange(true, std::memory_order_relaxed)) {
+                counter.m_error = std::current_exception();
+            }else {
+                log(Logger::LogType::Error, "Job threw after another job of the same counter already did");
+            }
+        }
+    }
+
+    void JobSystem::wakeWorker() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_sleeping.load(std::memory_order_relaxed) == 0) return;
+
+        m_wake.fetch_add(1, std::memory_order_release);
+        m_wake.notify_one();
+    }
+
+    bool JobSystem::hasWork() const {
+        if (m_sharedCount.load(std::memory_order_acquire) > 0) return true;
+        return std::any_of(m_workers.begin(), m_workers.end(), [](const auto& worker) {return !worker->deque.empty();});
+    }
+
+}
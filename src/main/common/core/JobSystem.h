@@ -0,0 +1,171 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Coreful {
+
+    //counts unfinished jobs, JobSystem::wait() returns once it reaches zero
+    class JobCounter {
+
+    public:
+
+        [[nodiscard]] bool isDone() const {return m_pending.load(std::memory_order_acquire) == 0;}
+
+    private:
+
+        friend class JobSystem;
+        std::atomic<uint32_t> m_pending{0};
+        std::atomic<bool> m_failed{false};
+        std::exception_ptr m_error;//the first job that threw, set before that job counts as done
+
+    };
+
+    //one worker per core, each with a Chase–Lev deque, idle workers steal from the others
+    //threads outside the pool submit through a shared queue and help run jobs while they wait
+    class JobSystem {
+
+    public:
+
+        JobSystem() = default;
+        ~JobSystem() {shutdown();}
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        //0 picks one worker per core, minus the thread that calls wait()
+        void init(uint32_t workerCount = 0);
+        void shutdown();
+
+        //counter has to outlive the job
+        void run(JobCounter& counter, std::function<void()> task);
+
+        //runs other jobs until counter is done, may be called from inside a job,
+        //then rethrows the first exception one of its jobs threw
+        void wait(JobCounter& counter);
+
+        [[nodiscard]] uint32_t getWorkerCount() const {return static_cast<uint32_t>(m_workers.size());}
+
+        //function(begin, end) over [0, count) in chunks of at least grainSize
+        template <typename Function>
+        void parallelFor(size_t count, size_t grainSize, Function&& function);
+
+        template <typename Iterator, typename Compare = std::less<>>
+        void parallelSort(Iterator begin, Iterator end, Compare compare = {});
+
+        constexpr static size_t DEQUE_CAPACITY = 4096;//must be a power of two
+
+    private:
+
+        struct Job {
+            std::function<void()> task;
+            JobCounter* counter = nullptr;
+        };
+
+        //owner pushes and pops at the bottom, thieves take from the top
+        class WorkStealingDeque {
+
+        public:
+
+            bool push(Job* job);
+            Job* pop();
+            Job* steal();
+            [[nodiscard]] bool empty() const;
+
+        private:
+
+            alignas(64) std::atomic<int64_t> m_top{0};
+            alignas(64) std::atomic<int64_t> m_bottom{0};
+            alignas(64) std::atomic<Job*> m_jobs[DEQUE_CAPACITY]{};
+
+        };
+
+        struct Worker {
+            WorkStealingDeque deque;
+            std::thread thread;
+        };
+
+        std::vector<std::unique_ptr<Worker>> m_workers;
+        std::atomic<bool> m_stopping{false};
+
+        std::mutex m_sharedMutex;//jobs submitted from threads outside the pool
+        std::deque<Job*> m_sharedJobs;
+        std::atomic<size_t> m_sharedCount{0};
+
+        alignas(64) std::atomic<uint32_t> m_wake{0};
+        std::atomic<uint32_t> m_sleeping{0};
+        //bumped whenever a counter reaches zero, waiters sleep on this instead of the counter, which may be gone by then
+        std::atomic<uint32_t> m_counterWake{0};
+
+        void workerLoop(uint32_t index);
+        Job* findJob();
+        void execute(Job* job);
+        static void invoke(JobCounter& counter, const std::function<void()>& task);
+        void wakeWorker();
+        [[nodiscard]] bool hasWork() const;
+
+    };
+
+    template <typename Function>
+    void JobSystem::parallelFor(const size_t count, const size_t grainSize, Function&& function) {
+        if (count == 0) return;
+
+        //a few chunks per thread so uneven chunks still balance out
+        const size_t threads = m_workers.size() + 1;
+        const size_t chunk = std::max(std::max<size_t>(grainSize, 1), (count + threads * 4 - 1) / (threads * 4));
+
+        if (chunk >= count || m_workers.empty()) {
+            function(size_t{0}, count);
+            return;
+        }
+
+        JobCounter counter;
+        for (size_t begin = chunk; begin < count; begin += chunk) {
+            const size_t end = std::min(begin + chunk, count);
+            run(counter, [&function, begin, end] {function(begin, end);});
+        }
+        //the caller takes the first chunk itself, it still waits for the rest if that one throws
+        invoke(counter, [&function, chunk] {function(size_t{0}, chunk);});
+
+        wait(counter);
+    }
+
+    template <typename Iterator, typename Compare>
+    void JobSystem::parallelSort(const Iterator begin, const Iterator end, Compare compare) {
+        const auto count = static_cast<size_t>(std::distance(begin, end));
+        constexpr size_t MIN_RUN = 2048;//below this a plain std::sort wins
+
+        //a power of two, so the pairwise merges below always come out even
+        const size_t runs = std::bit_floor(std::min(std::bit_ceil(m_workers.size() + 1), std::max<size_t>(count / MIN_RUN, 1)));
+        if (runs <= 1) {
+            std::sort(begin, end, compare);
+            return;
+        }
+
+        //sort equal runs in parallel, then merge neighbours pairwise until one run is left
+        std::vector<Iterator> bounds(runs + 1);
+        for (size_t i = 0; i <= runs; i++) bounds[i] = std::next(begin, static_cast<std::ptrdiff_t>(count * i / runs));
+
+        parallelFor(runs, 1, [&](const size_t first, const size_t last) {
+            for (size_t i = first; i < last; i++) std::sort(bounds[i], bounds[i + 1], compare);
+        });
+
+        for (size_t width = 1; width < runs; width *= 2) {
+            parallelFor(runs / (width * 2), 1, [&](const size_t first, const size_t last) {
+                for (size_t pair = first; pair < last; pair++) {
+                    const size_t left = pair * width * 2;
+                    std::inplace_merge(bounds[left], bounds[left + width], bounds[left + width * 2], compare);
+                }
+            });
+        }
+    }
+}
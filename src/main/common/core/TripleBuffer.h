@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace Coreful {
+
+    //hands the latest value from one writer thread to one reader thread without locks or waiting,
+    //the writer fills back(), publish() swaps it with the middle buffer and update() swaps that to the front
+    template <typename T>
+    class TripleBuffer {
+
+    public:
+
+        T& back() {return m_buffers[m_back];}
+
+        void publish() {
+            const uint8_t previous = m_middle.exchange(static_cast<uint8_t>(m_back | DIRTY), std::memory_order_acq_rel);
+            m_back = previous & INDEX_MASK;
+            m_middle.notify_one();
+        }
+
+        //true when a newer value was published since the last call, front() then returns it
+        bool update() {
+            if (!(m_middle.load(std::memory_order_relaxed) & DIRTY)) return false;
+
+            const uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+            m_front = previous & INDEX_MASK;
+            return true;
+        }
+
+        [[nodiscard]] const T& front() const {return m_buffers[m_front];}
+
+        //blocks the reader until there is something for update() to pick up
+        void waitForPublish() const {
+            uint8_t middle = m_middle.load(std::memory_order_acquire);
+            while (!(middle & DIRTY)) {
+                m_middle.wait(middle, std::memory_order_acquire);
+                middle = m_middle.load(std::memory_order_acquire);
+            }
+        }
+
+        //the reader has not picked up the last publish() yet
+        [[nodiscard]] bool hasUnread() const {return m_middle.load(std::memory_order_acquire) & DIRTY;}
+
+    private:
+
+        constexpr static uint8_t DIRTY = 0x4;
+        constexpr static uint8_t INDEX_MASK = 0x3;
+
+        T m_buffers[3]{};
+
+        alignas(64) uint8_t m_back = 0;//writer only
+        alignas(64) std::atomic<uint8_t> m_middle{1};
+        alignas(64) uint8_t m_front = 2;//reader only
+
+    };
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <span>
+
+namespace Coreful {
+
+    //in framebuffer pixels, origin at the top left like QuadInstance
+    struct DamageRect {
+        int32_t x = 0, y = 0;
+        uint32_t width = 0, height = 0;
+
+        [[nodiscard]] bool isEmpty() const {return width == 0 || height == 0;}
+        [[nodiscard]] uint64_t area() const {return static_cast<uint64_t>(width) * height;}
+
+        //smallest rect covering a quad given in float pixels
+        static DamageRect fromBounds(const float x, const float y, const float width, const float height) {
+            const auto left = static_cast<int32_t>(std::floor(x));
+            const auto top = static_cast<int32_t>(std::floor(y));
+            const auto right = static_cast<int32_t>(std::ceil(x + width));
+            const auto bottom = static_cast<int32_t>(std::ceil(y + height));
+            if (right <= left || bottom <= top) return {};
+            return {left, top, static_cast<uint32_t>(right - left), static_cast<uint32_t>(bottom - top)};
+        }
+
+        static DamageRect unite(const DamageRect& a, const DamageRect& b) {
+            if (a.isEmpty()) return b;
+            if (b.isEmpty()) return a;
+            const int32_t left = std::min(a.x, b.x);
+            const int32_t top = std::min(a.y, b.y);
+            const int64_t right = std::max<int64_t>(a.x + static_cast<int64_t>(a.width), b.x + static_cast<int64_t>(b.width));
+            const int64_t bottom = std::max<int64_t>(a.y + static_cast<int64_t>(a.height), b.y + static_cast<int64_t>(b.height));
+            return {left, top, static_cast<uint32_t>(right - left), static_cast<uint32_t>(bottom - top)};
+        }
+
+        //the part inside [0, width) x [0, height)
+        [[nodiscard]] DamageRect clipped(const uint32_t clipWidth, const uint32_t clipHeight) const {
+            const int64_t left = std::max<int64_t>(x, 0);
+            const int64_t top = std::max<int64_t>(y, 0);
+            const int64_t right = std::min<int64_t>(x + static_cast<int64_t>(width), clipWidth);
+            const int64_t bottom = std::min<int64_t>(y + static_cast<int64_t>(height), clipHeight);
+            if (right <= left || bottom <= top) return {};
+            return {static_cast<int32_t>(left), static_cast<int32_t>(top), static_cast<uint32_t>(right - left), static_cast<uint32_t>(bottom - top)};
+        }
+    };
+
+    //the parts of a frame that changed, a few rects that get merged once there are too many
+    class DamageRegion {
+
+    public:
+
+        void add(const DamageRect& rect) {
+            if (m_full || rect.isEmpty()) return;
+
+            if (m_count < MAX_RECTS) {
+                m_rects[m_count++] = rect;
+                return;
+            }
+
+            //full, grow whichever rect gains the least area by swallowing this one
+            uint32_t best = 0;
+            uint64_t bestGrowth = UINT64_MAX;
+            for (uint32_t i = 0; i < m_count; i++) {
+                const uint64_t growth = DamageRect::unite(m_rects[i], rect).area() - m_rects[i].area();
+                if (growth < bestGrowth) {
+                    best = i;
+                    bestGrowth = growth;
+                }
+            }
+            m_rects[best] = DamageRect::unite(m_rects[best], rect);
+        }
+
+        void merge(const DamageRegion& other) {
+            if (other.m_full) markFull();
+            for (const DamageRect& rect : other.getRects()) add(rect);
+        }
+
+        //everything changed, individual rects stop mattering
+        void markFull() {
+            m_full = true;
+            m_count = 0;
+        }
+
+        void clear() {
+            m_full = false;
+            m_count = 0;
+        }
+
+        [[nodiscard]] bool isFull() const {return m_full;}
+        [[nodiscard]] bool isEmpty() const {return !m_full && m_count == 0;}
+
+        //empty while full
+        [[nodiscard]] std::span<const DamageRect> getRects() const {return {m_rects.data(), m_count};}
+
+        [[nodiscard]] DamageRect getBounds(const uint32_t width, const uint32_t height) const {
+            if (m_full) return {0, 0, width, height};
+
+            DamageRect bounds;
+            for (const DamageRect& rect : getRects()) bounds = DamageRect::unite(bounds, rect);
+            return bounds.clipped(width, height);
+        }
+
+        constexpr static uint32_t MAX_RECTS = 16;
+
+    private:
+
+        std::array<DamageRect, MAX_RECTS> m_rects{};
+        uint32_t m_count = 0;
+        bool m_full = false;
+
+    };
+}
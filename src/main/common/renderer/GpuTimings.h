@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace Coreful {
+
+    struct GpuScopeTiming {
+        const char* name = nullptr;
+        double milliseconds = 0.0;
+    };
+
+    //gpu durations of every profiled scope of one finished frame
+    struct GpuFrameTimings {
+        uint64_t frame = 0;
+        std::vector<GpuScopeTiming> scopes;
+    };
+}
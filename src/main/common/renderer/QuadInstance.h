@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+
+namespace Coreful {
+
+    //per-instance data of one batched rectangle, laid out exactly as the vertex shader reads it
+    struct QuadInstance {
+        float x = 0.f, y = 0.f;//top left, in pixels
+        float width = 0.f, height = 0.f;
+        float r = 1.f, g = 1.f, b = 1.f, a = 1.f;//multiplies the texture
+        uint32_t textureIndex = 0;//into the renderer's texture table, 0 is plain white
+    };
+
+    static_assert(sizeof(QuadInstance) == 8 * sizeof(float) + sizeof(uint32_t), "QuadInstance must stay tightly packed for the instance buffer");
+}
@@ -1,16 +1,43 @@
 #pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "DamageRegion.h"
+#include "GpuTimings.h"
+#include "QuadInstance.h"
 #include "platform/PlatformWindow.h"
 
 namespace Coreful{
 
     enum class RendererType { VULKAN, OPENGL, USER_PREFERENCE };
 
+    enum class PresentMode {
+        Fifo,//vsync, never tears, lowest power
+        FifoRelaxed,//vsync, tears instead of waiting when a frame is late
+        Mailbox,//vsync, the newest frame replaces a queued one
+        Immediate//no vsync, tears
+    };
+
     class Renderer {
     public:
         virtual ~Renderer() = default;
 
         virtual void init(PlatformWindow& window) = 0;
+        virtual void initHeadless(uint32_t width, uint32_t height) = 0;//no surface, renders into offscreen targets
+        virtual void beginFrame() = 0;//waits until the next frame's buffers are free to fill
+        virtual void submitQuad(const QuadInstance& quad) = 0;
         virtual void render() = 0;
+        virtual void resize(uint32_t width, uint32_t height) = 0;//the swapchain is rebuilt before the next frame
+        virtual void setPresentMode(PresentMode mode) = 0;//any thread, applied on the next frame, fifo when the surface lacks it
+        virtual void setPreferredDevice(const std::string& nameOrUUID) = 0;//before init, COREFUL_GPU overrides it, the best gpu when nothing matches
+        virtual void setLowLatency(bool enabled) = 0;//any thread, beginFrame() waits until at most one frame is queued for display
+        virtual void setDamageTracking(bool enabled) = 0;//any thread, frames only redraw what addDamage() reported and are skipped without any
+        virtual void addDamage(const DamageRect& rect) = 0;
+        virtual void invalidate() = 0;//everything is redrawn, the window's contents were lost or the swapchain is new
+        [[nodiscard]] virtual bool needsRedraw() const = 0;//damage that has not been presented yet, always true without damage tracking
+        virtual bool readPixels(std::vector<uint8_t>& pixels) = 0;//headless only, pixels of the last rendered frame
+        virtual bool getGpuTimings(uint32_t framesAgo, GpuFrameTimings& timings) const = 0;//0 is the latest finished frame
         virtual void cleanup() = 0;
     };
 }
@@ -0,0 +1,25 @@
+
+#include "ShaderRegistry.h"
+
+#include <stdexcept>
+#include <string>
+
+#include "EmbeddedShaders.h"
+
+namespace Coreful::renderer::vulkan {
+
+    std::span<const uint32_t> ShaderRegistry::get(const std::string_view name) {
+        for (const auto& shader : shaders::EMBEDDED_SHADERS) {
+            if (shader.name == name) return shader.code;
+        }
+        throw std::runtime_error("Shader not embedded: " + std::string(name));
+    }
+
+    bool ShaderRegistry::contains(const std::string_view name) {
+        for (const auto& shader : shaders::EMBEDDED_SHADERS) {
+            if (shader.name == name) return true;
+        }
+        return false;
+    }
+
+}
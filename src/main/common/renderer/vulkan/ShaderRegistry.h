@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace Coreful::renderer::vulkan {
+
+    //SPIR-V compiled from shaders/*.glsl at build time and embedded in the binary
+    class ShaderRegistry {
+
+    public:
+
+        //name is the glsl file name without extension, e.g. "vert"
+        static std::span<const uint32_t> get(std::string_view name);
+
+        [[nodiscard]] static bool contains(std::string_view name);
+
+    };
+
+}
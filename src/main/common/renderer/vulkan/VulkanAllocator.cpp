@@ -0,0 +1,351 @@
+
+#include "VulkanAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "VulkanMemoryUtils.h"
+#include "util/Logger.h"
+
+namespace Coreful::renderer::vulkan {
+
+    void VulkanAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device) {
+        m_physicalDevice = physicalDevice;
+        m_device = device;
+        vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+        m_nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+        LOG_DEBUGF("Allocator Created! (max allocations: {})", properties.limits.maxMemoryAllocationCount);
+    }
+
+    void VulkanAllocator::cleanup() {
+        std::lock_guard lock(m_mutex);
+
+        for (auto& pool : m_pools) {
+            for (const auto& block : pool.blocks) {
+                if (block->used != 0) {
+                    log(Logger::LogType::Warn, "Allocator block of memory type ", pool.memoryTypeIndex, " still has ", block->used, " bytes in use");
+                }
+                vkFreeMemory(m_device, block->memory, nullptr);//implicitly unmaps
+            }
+        }
+        m_pools.clear();
+        m_deviceMemoryCount = 0;
+    }
+
+    Allocation VulkanAllocator::createBuffer(const VkBufferCreateInfo& bufferInfo, const MemoryUsage usage, VkBuffer& buffer) {
+        if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create buffer!");
+        }
+
+        VkMemoryDedicatedRequirements dedicatedRequirements{};
+        dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+        VkMemoryRequirements2 requirements{};
+        requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        requirements.pNext = &dedicatedRequirements;
+
+        VkBufferMemoryRequirementsInfo2 requirementsInfo{};
+        requirementsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+        requirementsInfo.buffer = buffer;
+
+        vkGetBufferMemoryRequirements2(m_device, &requirementsInfo, &requirements);
+
+        const bool dedicated = dedicatedRequirements.requiresDedicatedAllocation || dedicatedRequirements.prefersDedicatedAllocation;
+        Allocation allocation = allocate(requirements.memoryRequirements, usage, true, dedicated, buffer, VK_NULL_HANDLE);
+
+        if (vkBindBufferMemory(m_device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to bind buffer memory!");
+        }
+        return allocation;
+    }
+
+    Allocation VulkanAllocator::createImage(const VkImageCreateInfo& imageInfo, const MemoryUsage usage, VkImage& image) {
+        if (VkResult result = vkCreateImage(m_device, &imageInfo, nullptr, &image); result != VK_SUCCESS) {
+            log(Logger::LogType::Error, "vkCreateImage failed! with code: ", result);
+            throw std::runtime_error("Failed to create image!");
+        }
+
+        VkMemoryDedicatedRequirements dedicatedRequirements{};
+        dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+        VkMemoryRequirements2 requirements{};
+        requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        requirements.pNext = &dedicatedRequirements;
+
+        VkImageMemoryRequirementsInfo2 requirementsInfo{};
+        requirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+        requirementsInfo.image = image;
+
+        vkGetImageMemoryRequirements2(m_device, &requirementsInfo, &requirements);
+
+        const bool linear = imageInfo.tiling == VK_IMAGE_TILING_LINEAR;
+        const bool dedicated = dedicatedRequirements.requiresDedicatedAllocation || dedicatedRequirements.prefersDedicatedAllocation;
+        Allocation allocation = allocate(requirements.memoryRequirements, usage, linear, dedicated, VK_NULL_HANDLE, image);
+
+        if (vkBindImageMemory(m_device, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to bind image memory!");
+        }
+        return allocation;
+    }
+
+    void VulkanAllocator::destroyBuffer(VkBuffer buffer, Allocation& allocation) {
+        vkDestroyBuffer(m_device, buffer, nullptr);
+        free(allocation);
+    }
+
+    void VulkanAllocator::destroyImage(VkImage image, Allocation& allocation) {
+        vkDestroyImage(m_device, image, nullptr);
+        free(allocation);
+    }
+
+    Allocation VulkanAllocator::allocateImageMemory(const VkMemoryRequirements& requirements, const MemoryUsage usage) {
+        return allocate(requirements, usage, false, false, VK_NULL_HANDLE, VK_NULL_HANDLE);
+    }
+
+    void VulkanAllocator::freeMemory(Allocation& allocation) {
+        free(allocation);
+    }
+
+    void VulkanAllocator::flush(const Allocation& allocation) const {
+        if (allocation.coherent || allocation.mapped == nullptr) return;
+
+        const VkMappedMemoryRange range = alignedRange(allocation);
+        vkFlushMappedMemoryRanges(m_device, 1, &range);
+    }
+
+    void VulkanAllocator::invalidate(const Allocation& allocation) const {
+        if (allocation.coherent || allocation.mapped == nullptr) return;
+
+        const VkMappedMemoryRange range = alignedRange(allocation);
+        vkInvalidateMappedMemoryRanges(m_device, 1, &range);
+    }
+
+    Allocation VulkanAllocator::allocate(const VkMemoryRequirements& requirements, const MemoryUsage usage, const bool linear,
+        const bool dedicated, VkBuffer dedicatedBuffer, VkImage dedicatedImage) {
+
+        const uint32_t memoryTypeIndex = chooseMemoryType(requirements.memoryTypeBits, usage);
+
+        //buddies are aligned to their own size, so rounding up to the alignment is enough
+        const VkDeviceSize size = std::max(requirements.size, requirements.alignment);
+
+        //large resources would waste most of a block
+        if (dedicated || size > BLOCK_SIZE / 2) {
+            return allocateDedicated(requirements, memoryTypeIndex, dedicatedBuffer, dedicatedImage);
+        }
+
+        std::lock_guard lock(m_mutex);
+
+        uint32_t poolIndex;
+        MemoryPool& pool = getPool(memoryTypeIndex, linear, poolIndex);
+        const uint32_t order = orderFor(size);
+
+        VkDeviceSize offset = 0;
+        auto blockIndex = static_cast<uint32_t>(pool.blocks.size());
+        for (uint32_t i = 0; i < pool.blocks.size(); i++) {
+            if (allocateFromBlock(*pool.blocks[i], order, offset)) {
+                blockIndex = i;
+                break;
+            }
+        }
+
+        if (blockIndex == pool.blocks.size()) {
+            createBlock(pool);
+            allocateFromBlock(*pool.blocks.back(), order, offset);
+        }
+
+        MemoryBlock& block = *pool.blocks[blockIndex];
+        block.used += MIN_ALLOCATION_SIZE << order;
+
+        Allocation allocation{};
+        allocation.memory = block.memory;
+        allocation.offset = offset;
+        allocation.size = MIN_ALLOCATION_SIZE << order;
+        allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + offset : nullptr;
+        allocation.coherent = isCoherent(memoryTypeIndex);
+        allocation.pool = poolIndex;
+        allocation.block = blockIndex;
+        allocation.order = order;
+        return allocation;
+    }
+
+    Allocation VulkanAllocator::allocateDedicated(const VkMemoryRequirements& requirements, const uint32_t memoryTypeIndex,
+        VkBuffer buffer, VkImage image) {
+
+        VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+        dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+        dedicatedInfo.buffer = buffer;
+        dedicatedInfo.image = image;
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.pNext = &dedicatedInfo;
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+        Allocation allocation{};
+        if (vkAllocateMemory(m_device, &allocInfo, nullptr, &allocation.memory) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate dedicated memory!");
+        }
+
+        if (isHostVisible(memoryTypeIndex)) {
+            if (vkMapMemory(m_device, allocation.memory, 0, VK_WHOLE_SIZE, 0, &allocation.mapped) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to map dedicated memory!");
+            }
+        }
+
+        allocation.size = requirements.size;
+        allocation.coherent = isCoherent(memoryTypeIndex);
+        allocation.dedicated = true;
+
+        std::lock_guard lock(m_mutex);
+        m_deviceMemoryCount++;
+        return allocation;
+    }
+
+    void VulkanAllocator::free(Allocation& allocation) {
+        if (allocation.memory == VK_NULL_HANDLE) return;
+
+        std::lock_guard lock(m_mutex);
+
+        if (allocation.dedicated) {
+            vkFreeMemory(m_device, allocation.memory, nullptr);
+            m_deviceMemoryCount--;
+        } else {
+            //blocks are kept until cleanup so they can be reused without another vkAllocateMemory
+            MemoryBlock& block = *m_pools[allocation.pool].blocks[allocation.block];
+            freeToBlock(block, allocation.order, allocation.offset);
+            block.used -= allocation.size;
+        }
+        allocation = {};
+    }
+
+    uint32_t VulkanAllocator::chooseMemoryType(const uint32_t typeBits, const MemoryUsage usage) const {
+        switch (usage) {
+            case MemoryUsage::GpuOnly:
+                return findMemoryType(m_memoryProperties, typeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            case MemoryUsage::CpuToGpu:
+                return findMemoryType(m_memoryProperties, typeBits,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            case MemoryUsage::GpuToCpu:
+                return findMemoryType(m_memoryProperties, typeBits,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT);//cached reads are much faster on the cpu
+        }
+        throw std::runtime_error("Unknown memory usage!");
+    }
+
+    bool VulkanAllocator::isHostVisible(const uint32_t memoryTypeIndex) const {
+        return (m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+    }
+
+    bool VulkanAllocator::isCoherent(const uint32_t memoryTypeIndex) const {
+        return (m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+    }
+
+    VkMappedMemoryRange VulkanAllocator::alignedRange(const Allocation& allocation) const {
+        //flush and invalidate ranges have to be multiples of nonCoherentAtomSize
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = allocation.memory;
+
+        if (allocation.dedicated) {
+            range.offset = 0;
+            range.size = VK_WHOLE_SIZE;
+            return range;
+        }
+
+        range.offset = allocation.offset / m_nonCoherentAtomSize * m_nonCoherentAtomSize;
+        const VkDeviceSize end = (allocation.offset + allocation.size + m_nonCoherentAtomSize - 1) / m_nonCoherentAtomSize * m_nonCoherentAtomSize;
+        range.size = std::min(end, BLOCK_SIZE) - range.offset;
+        return range;
+    }
+
+    VulkanAllocator::MemoryPool& VulkanAllocator::getPool(const uint32_t memoryTypeIndex, const bool linear, uint32_t& poolIndex) {
+        for (uint32_t i = 0; i < m_pools.size(); i++) {
+            if (m_pools[i].memoryTypeIndex == memoryTypeIndex && m_pools[i].linear == linear) {
+                poolIndex = i;
+                return m_pools[i];
+            }
+        }
+
+        MemoryPool pool;
+        pool.memoryTypeIndex = memoryTypeIndex;
+        pool.linear = linear;
+        m_pools.push_back(std::move(pool));
+
+        poolIndex = static_cast<uint32_t>(m_pools.size() - 1);
+        return m_pools.back();
+    }
+
+    void VulkanAllocator::createBlock(MemoryPool& pool) {
+        auto block = std::make_unique<MemoryBlock>();
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = BLOCK_SIZE;
+        allocInfo.memoryTypeIndex = pool.memoryTypeIndex;
+
+        if (vkAllocateMemory(m_device, &allocInfo, nullptr, &block->memory) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate memory block!");
+        }
+
+        //host visible blocks stay mapped for their whole lifetime
+        if (isHostVisible(pool.memoryTypeIndex)) {
+            if (vkMapMemory(m_device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to map memory block!");
+            }
+        }
+
+        //the whole block starts out as a single free buddy of the highest order
+        block->freeLists.resize(orderCount());
+        block->freeLists.back().insert(0);
+
+        pool.blocks.push_back(std::move(block));
+        m_deviceMemoryCount++;
+
+        LOG_DEBUGF("Allocator block created for memory type {} ({})", pool.memoryTypeIndex, pool.linear ? "linear" : "optimal");
+    }
+
+    uint32_t VulkanAllocator::orderCount() {
+        return orderFor(BLOCK_SIZE) + 1;
+    }
+
+    uint32_t VulkanAllocator::orderFor(const VkDeviceSize size) {
+        uint32_t order = 0;
+        while ((MIN_ALLOCATION_SIZE << order) < size) order++;
+        return order;
+    }
+
+    bool VulkanAllocator::allocateFromBlock(MemoryBlock& block, const uint32_t order, VkDeviceSize& offset) {
+        //smallest free buddy that fits
+        uint32_t current = order;
+        while (current < block.freeLists.size() && block.freeLists[current].empty()) current++;
+        if (current == block.freeLists.size()) return false;
+
+        offset = *block.freeLists[current].begin();
+        block.freeLists[current].erase(block.freeLists[current].begin());
+
+        //split down, the upper halves become free buddies
+        while (current > order) {
+            current--;
+            block.freeLists[current].insert(offset + (MIN_ALLOCATION_SIZE << current));
+        }
+        return true;
+    }
+
+    void VulkanAllocator::freeToBlock(MemoryBlock& block, uint32_t order, VkDeviceSize offset) {
+        //merge with the buddy for as long as it is free too
+        while (order + 1 < block.freeLists.size()) {
+            const VkDeviceSize buddy = offset ^ (MIN_ALLOCATION_SIZE << order);
+            if (block.freeLists[order].erase(buddy) == 0) break;
+
+            offset = std::min(offset, buddy);
+            order++;
+        }
+        block.freeLists[order].insert(offset);
+    }
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Coreful::renderer::vulkan {
+
+    enum class MemoryUsage {
+        GpuOnly,//device local, never touched by the cpu
+        CpuToGpu,//host visible and coherent, written by the cpu every frame
+        GpuToCpu//host visible, cached when possible, for readback
+    };
+
+    //a range of device memory handed out by VulkanAllocator
+    struct Allocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void* mapped = nullptr;//only set for host visible memory, already offset
+        bool coherent = false;
+
+        //bookkeeping for free
+        bool dedicated = false;
+        uint32_t pool = 0;
+        uint32_t block = 0;
+        uint32_t order = 0;
+    };
+
+    //carves buffers and images out of large vkAllocateMemory blocks with a buddy scheme
+    class VulkanAllocator {
+
+    public:
+
+        void init(VkPhysicalDevice physicalDevice, VkDevice device);
+        void cleanup();
+
+        //creates the resource and binds memory to it
+        Allocation createBuffer(const VkBufferCreateInfo& bufferInfo, MemoryUsage usage, VkBuffer& buffer);
+        Allocation createImage(const VkImageCreateInfo& imageInfo, MemoryUsage usage, VkImage& image);
+
+        void destroyBuffer(VkBuffer buffer, Allocation& allocation);
+        void destroyImage(VkImage image, Allocation& allocation);
+
+        //memory for optimal images the caller binds itself, so several of them can alias it
+        Allocation allocateImageMemory(const VkMemoryRequirements& requirements, MemoryUsage usage);
+        void freeMemory(Allocation& allocation);
+
+        //no-ops on coherent memory
+        void flush(const Allocation& allocation) const;
+        void invalidate(const Allocation& allocation) const;
+
+        [[nodiscard]] VkPhysicalDevice getPhysicalDevice() const {return m_physicalDevice;}
+        [[nodiscard]] VkDevice getDevice() const {return m_device;}
+        [[nodiscard]] uint32_t getDeviceMemoryCount() const {return m_deviceMemoryCount;}
+
+        constexpr static VkDeviceSize BLOCK_SIZE = VkDeviceSize{64} * 1024 * 1024;
+        constexpr static VkDeviceSize MIN_ALLOCATION_SIZE = 256;
+
+    private:
+
+        //one vkAllocateMemory, split into power of two sized buddies
+        struct MemoryBlock {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            void* mapped = nullptr;
+            std::vector<std::set<VkDeviceSize>> freeLists;//free offsets per order
+            VkDeviceSize used = 0;
+        };
+
+        //blocks of one memory type, buffers (linear) and images (optimal) never share a pool so bufferImageGranularity can't conflict
+        struct MemoryPool {
+            uint32_t memoryTypeIndex = 0;
+            bool linear = true;
+            std::vector<std::unique_ptr<MemoryBlock>> blocks;
+        };
+
+        VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+        VkDevice m_device = VK_NULL_HANDLE;
+        VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+        VkDeviceSize m_nonCoherentAtomSize = 1;
+
+        std::vector<MemoryPool> m_pools;
+        uint32_t m_deviceMemoryCount = 0;
+
+        mutable std::mutex m_mutex;
+
+        Allocation allocate(const VkMemoryRequirements& requirements, MemoryUsage usage, bool linear, bool dedicated,
+            VkBuffer dedicatedBuffer, VkImage dedicatedImage);
+        Allocation allocateDedicated(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex,
+            VkBuffer buffer, VkImage image);
+        void free(Allocation& allocation);
+
+        [[nodiscard]] uint32_t chooseMemoryType(uint32_t typeBits, MemoryUsage usage) const;
+        [[nodiscard]] bool isHostVisible(uint32_t memoryTypeIndex) const;
+        [[nodiscard]] bool isCoherent(uint32_t memoryTypeIndex) const;
+        [[nodiscard]] VkMappedMemoryRange alignedRange(const Allocation& allocation) const;
+
+        MemoryPool& getPool(uint32_t memoryTypeIndex, bool linear, uint32_t& poolIndex);
+        void createBlock(MemoryPool& pool);
+
+        static uint32_t orderCount();
+        static uint32_t orderFor(VkDeviceSize size);
+        static bool allocateFromBlock(MemoryBlock& block, uint32_t order, VkDeviceSize& offset);
+        static void freeToBlock(MemoryBlock& block, uint32_t order, VkDeviceSize offset);
+
+    };
+
+}
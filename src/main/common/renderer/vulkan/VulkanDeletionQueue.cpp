@@ -0,0 +1,27 @@
+
+#include "VulkanDeletionQueue.h"
+
+#include <algorithm>
+
+namespace Coreful::renderer::vulkan {
+
+    void VulkanDeletionQueue::push(const uint64_t frame, std::function<void()> destroy) {
+        //kept sorted, retirements almost always come in frame order so this is an append
+        const auto position = std::ranges::upper_bound(m_entries, frame, {}, &Entry::frame);
+        m_entries.insert(position, Entry{frame, std::move(destroy)});
+    }
+
+    void VulkanDeletionQueue::flush(const uint64_t completedFrame) {
+        while (!m_entries.empty() && m_entries.front().frame <= completedFrame) {
+            //popped first, so a throwing destroy can't run twice
+            const std::function<void()> destroy = std::move(m_entries.front().destroy);
+            m_entries.pop_front();
+            destroy();
+        }
+    }
+
+    void VulkanDeletionQueue::flushAll() {
+        flush(UINT64_MAX);
+    }
+
+}
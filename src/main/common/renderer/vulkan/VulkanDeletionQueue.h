@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+namespace Coreful::renderer::vulkan {
+
+    //destroys retired resources once the last frame that could still use them has finished on the gpu,
+    //keyed by frame timeline value, which only ever grows so reaching one means every earlier one was reached too
+    class VulkanDeletionQueue {
+
+    public:
+
+        //destroy runs once the timeline has reached frame
+        void push(uint64_t frame, std::function<void()> destroy);
+
+        //runs everything retired up to and including completedFrame, in the order it was pushed
+        void flush(uint64_t completedFrame);
+
+        //the device is idle, nothing can be in use anymore
+        void flushAll();
+
+        [[nodiscard]] bool isEmpty() const {return m_entries.empty();}
+
+    private:
+
+        struct Entry {
+            uint64_t frame;
+            std::function<void()> destroy;
+        };
+
+        std::deque<Entry> m_entries;
+
+    };
+
+}
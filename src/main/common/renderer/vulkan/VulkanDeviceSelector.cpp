@@ -0,0 +1,266 @@
+
+#include "VulkanDeviceSelector.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include "VulkanPipelineCache.h"
+#include "util/Logger.h"
+
+namespace Coreful::renderer::vulkan {
+
+    std::vector<DeviceCandidate> VulkanDeviceSelector::rank(const VkInstance instance, const bool needsSwapchain, const std::string& preference) {
+        load();
+
+        uint32_t deviceCount = 0;
+        vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+        std::vector<VkPhysicalDevice> devices(deviceCount);
+        vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+
+        std::vector<DeviceCandidate> candidates;
+        for (const VkPhysicalDevice device : devices) {
+            DeviceCandidate candidate;
+            candidate.device = device;
+            candidate.capabilities = query(device);
+            candidate.score = score(candidate.capabilities, needsSwapchain);
+
+            LOG_DEBUGF("Gpu {} ({}, {} MiB, score {})", candidate.capabilities.name, typeName(candidate.capabilities.type),
+                candidate.capabilities.deviceLocalMemory >> 20, candidate.score);
+
+            if (candidate.score >= 0) candidates.push_back(candidate);
+        }
+
+        std::ranges::stable_sort(candidates, [](const DeviceCandidate& a, const DeviceCandidate& b) {return a.score > b.score;});
+
+        //the environment wins over code, so a single run can be pointed at another gpu
+        std::string wanted = preference;
+        if (const char* variable = std::getenv(OVERRIDE_VARIABLE); variable && *variable) wanted = variable;
+
+        if (!wanted.empty()) {
+            const auto preferred = std::ranges::find_if(candidates, [&wanted](const DeviceCandidate& candidate) {
+                return matches(candidate.capabilities, wanted);
+            });
+
+            if (preferred != candidates.end()) {
+                std::rotate(candidates.begin(), preferred, preferred + 1);
+            }else {
+                log(Logger::LogType::Warn, "No usable gpu matches \"", wanted, "\", picking the best one instead");
+            }
+        }
+
+        return candidates;
+    }
+
+    void VulkanDeviceSelector::save() const {
+        if (!m_cacheChanged) return;
+
+        DeviceCacheHeader header{};
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.count = static_cast<uint32_t>(m_cache.size());
+        header.checksum = VulkanPipelineCache::checksum(reinterpret_cast<const char*>(m_cache.data()), m_cache.size() * sizeof(DeviceCapabilities));
+
+        std::error_code error;
+        std::filesystem::create_directories(m_path.parent_path(), error);
+
+        std::filesystem::path tempPath = m_path;
+        tempPath += ".tmp";
+
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(m_cache.data()), static_cast<std::streamsize>(m_cache.size() * sizeof(DeviceCapabilities)));
+
+            if (!file) {
+                log(Logger::LogType::Warn, "Failed to write device cache to ", tempPath.string());
+                file.close();
+                std::filesystem::remove(tempPath, error);
+                return;
+            }
+        }
+
+        std::filesystem::rename(tempPath, m_path, error);
+        if (error) {
+            log(Logger::LogType::Warn, "Failed to replace device cache: ", error.message());
+            std::filesystem::remove(tempPath, error);
+            return;
+        }
+
+        LOG_DEBUGF("Device Cache Saved! ({} devices)", m_cache.size());
+    }
+
+    void VulkanDeviceSelector::load() {
+        m_path = VulkanPipelineCache::getCacheDirectory() / "device_cache.bin";
+        m_cache.clear();
+        m_cacheChanged = false;
+
+        std::ifstream file(m_path, std::ios::binary);
+        if (!file.is_open()) return;
+
+        DeviceCacheHeader header{};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file || header.magic != MAGIC || header.version != VERSION || header.count > MAX_CACHED_DEVICES) {
+            log(Logger::LogType::Warn, "Device cache has an unknown format, ignoring it");
+            return;
+        }
+
+        std::vector<DeviceCapabilities> entries(header.count);
+        file.read(reinterpret_cast<char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(DeviceCapabilities)));
+        if (!file || header.checksum != VulkanPipelineCache::checksum(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(DeviceCapabilities))) {
+            log(Logger::LogType::Warn, "Device cache is corrupted, ignoring it");
+            return;
+        }
+
+        m_cache = std::move(entries);
+    }
+
+    // ReSharper disable once CppParameterMayBeConst
+    DeviceCapabilities VulkanDeviceSelector::query(VkPhysicalDevice device) {
+        //identity is always queried, it is what tells whether the cached entry still describes this device and driver
+        VkPhysicalDeviceIDProperties idProperties{};
+        idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+        VkPhysicalDeviceProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &idProperties;
+        vkGetPhysicalDeviceProperties2(device, &properties);
+
+        for (const DeviceCapabilities& cached : m_cache) {
+            if (std::memcmp(cached.deviceUUID, idProperties.deviceUUID, VK_UUID_SIZE) == 0
+                && cached.driverVersion == properties.properties.driverVersion
+                && cached.apiVersion == properties.properties.apiVersion) {
+                return cached;
+            }
+        }
+
+        DeviceCapabilities capabilities{};
+        std::memcpy(capabilities.deviceUUID, idProperties.deviceUUID, VK_UUID_SIZE);
+        std::memcpy(capabilities.name, properties.properties.deviceName, VK_MAX_PHYSICAL_DEVICE_NAME_SIZE);
+        capabilities.name[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE - 1] = '\0';
+        capabilities.vendorID = properties.properties.vendorID;
+        capabilities.deviceID = properties.properties.deviceID;
+        capabilities.driverVersion = properties.properties.driverVersion;
+        capabilities.apiVersion = properties.properties.apiVersion;
+        capabilities.type = properties.properties.deviceType;
+        capabilities.maxImageDimension2D = properties.properties.limits.maxImageDimension2D;
+
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(device, &memoryProperties);
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+            if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                capabilities.deviceLocalMemory = std::max<uint64_t>(capabilities.deviceLocalMemory, memoryProperties.memoryHeaps[i].size);
+            }
+        }
+
+        //the 1.2 feature struct may only be chained on devices that report 1.2
+        VkPhysicalDeviceVulkan12Features vulkan12Features{};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        if (capabilities.apiVersion >= VK_API_VERSION_1_2) features.pNext = &vulkan12Features;
+        vkGetPhysicalDeviceFeatures2(device, &features);
+
+        capabilities.samplerAnisotropy = features.features.samplerAnisotropy;
+        capabilities.descriptorIndexing = vulkan12Features.descriptorIndexing && vulkan12Features.runtimeDescriptorArray
+            && vulkan12Features.shaderSampledImageArrayNonUniformIndexing && vulkan12Features.descriptorBindingSampledImageUpdateAfterBind
+            && vulkan12Features.descriptorBindingPartiallyBound && vulkan12Features.descriptorBindingVariableDescriptorCount;
+
+        uint32_t extensionCount = 0;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+        const auto isAvailable = [&extensions](const char* name) {
+            return std::ranges::any_of(extensions, [name](const VkExtensionProperties& extension) {
+                return strcmp(extension.extensionName, name) == 0;
+            });
+        };
+
+        if (isAvailable(VK_KHR_SWAPCHAIN_EXTENSION_NAME)) capabilities.extensions |= DEVICE_EXTENSION_SWAPCHAIN;
+        if (isAvailable(VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME)) capabilities.extensions |= DEVICE_EXTENSION_SWAPCHAIN_MAINTENANCE_1;
+        if (isAvailable(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME)) capabilities.extensions |= DEVICE_EXTENSION_INCREMENTAL_PRESENT;
+        if (isAvailable(VK_KHR_PRESENT_ID_EXTENSION_NAME) && isAvailable(VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+            capabilities.extensions |= DEVICE_EXTENSION_PRESENT_WAIT;
+        }
+
+        //an entry for the same device under an older driver is replaced, not kept alongside
+        std::erase_if(m_cache, [&capabilities](const DeviceCapabilities& cached) {
+            return std::memcmp(cached.deviceUUID, capabilities.deviceUUID, VK_UUID_SIZE) == 0;
+        });
+        m_cache.push_back(capabilities);
+        if (m_cache.size() > MAX_CACHED_DEVICES) m_cache.erase(m_cache.begin());//oldest first, likely a removed gpu
+        m_cacheChanged = true;
+
+        return capabilities;
+    }
+
+    int64_t VulkanDeviceSelector::score(const DeviceCapabilities& capabilities, const bool needsSwapchain) {
+        if (capabilities.apiVersion < VK_API_VERSION_1_2) return -1;//frame synchronization needs timeline semaphores
+        if (!capabilities.samplerAnisotropy) return -1;
+        if (!capabilities.descriptorIndexing) return -1;//the texture table
+        if (needsSwapchain && !(capabilities.extensions & DEVICE_EXTENSION_SWAPCHAIN)) return -1;
+
+        //the type decides, a cpu rasterizer is tens of times slower than any real gpu
+        int64_t score = 0;
+        switch (capabilities.type) {
+            case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: score = 100000; break;
+            case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: score = 50000; break;
+            case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: score = 20000; break;
+            case VK_PHYSICAL_DEVICE_TYPE_CPU: score = 0; break;
+            default: score = 10000; break;
+        }
+
+        //then memory and limits, between two gpus of the same type, capped so they never outweigh the type
+        score += static_cast<int64_t>(std::min<uint64_t>(capabilities.deviceLocalMemory >> 20, 32768));
+        score += std::min<int64_t>(capabilities.maxImageDimension2D / 1024, 32) * 64;
+
+        //optional extensions the renderer makes use of
+        if (capabilities.extensions & DEVICE_EXTENSION_SWAPCHAIN_MAINTENANCE_1) score += 256;
+        if (capabilities.extensions & DEVICE_EXTENSION_INCREMENTAL_PRESENT) score += 256;
+        if (capabilities.extensions & DEVICE_EXTENSION_PRESENT_WAIT) score += 256;
+
+        return score;
+    }
+
+    bool VulkanDeviceSelector::matches(const DeviceCapabilities& capabilities, const std::string& preference) {
+        const auto normalize = [](const std::string& text, const bool hexOnly) {
+            std::string result;
+            for (const char c : text) {
+                if (hexOnly && !std::isxdigit(static_cast<unsigned char>(c))) continue;
+                result += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            }
+            return result;
+        };
+
+        //a uuid with or without dashes, as printed by vulkaninfo
+        const std::string uuid = normalize(preference, true);
+        if (uuid.size() == VK_UUID_SIZE * 2 && uuid == normalize(formatUUID(capabilities.deviceUUID), true)) return true;
+
+        return normalize(capabilities.name, false).find(normalize(preference, false)) != std::string::npos;
+    }
+
+    std::string VulkanDeviceSelector::formatUUID(const uint8_t uuid[VK_UUID_SIZE]) {
+        constexpr char digits[] = "0123456789abcdef";
+        std::string result;
+        for (uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+            if (i == 4 || i == 6 || i == 8 || i == 10) result += '-';
+            result += digits[uuid[i] >> 4];
+            result += digits[uuid[i] & 0xF];
+        }
+        return result;
+    }
+
+    const char* VulkanDeviceSelector::typeName(const uint32_t type) {
+        switch (type) {
+            case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "discrete";
+            case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated";
+            case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "virtual";
+            case VK_PHYSICAL_DEVICE_TYPE_CPU: return "cpu";
+            default: return "other";
+        }
+    }
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Coreful::renderer::vulkan {
+
+    //what ranking a device needs, stored as is in the capability cache
+    struct DeviceCapabilities {
+        uint8_t deviceUUID[VK_UUID_SIZE];
+        char name[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE];
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint32_t apiVersion;
+        uint32_t type;//VkPhysicalDeviceType
+        uint32_t maxImageDimension2D;
+        uint64_t deviceLocalMemory;//largest device local heap
+        uint32_t extensions;//DeviceExtension bits
+        uint32_t samplerAnisotropy;
+        uint32_t descriptorIndexing;//every descriptor indexing feature the texture table needs
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(DeviceCapabilities) == 320, "DeviceCapabilities must not contain padding");
+
+    struct DeviceCacheHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t count;
+        uint32_t reserved;
+        uint64_t checksum;//of the entries following the header
+    };
+
+    static_assert(sizeof(DeviceCacheHeader) == 24, "DeviceCacheHeader must not contain padding");
+
+    enum DeviceExtension : uint32_t {
+        DEVICE_EXTENSION_SWAPCHAIN = 1 << 0,
+        DEVICE_EXTENSION_SWAPCHAIN_MAINTENANCE_1 = 1 << 1,
+        DEVICE_EXTENSION_INCREMENTAL_PRESENT = 1 << 2,
+        DEVICE_EXTENSION_PRESENT_WAIT = 1 << 3//together with present id
+    };
+
+    struct DeviceCandidate {
+        VkPhysicalDevice device = VK_NULL_HANDLE;
+        DeviceCapabilities capabilities{};
+        int64_t score = 0;//below 0 when it cannot run the renderer at all
+    };
+
+    //ranks every physical device, a discrete gpu beats an integrated one beats a cpu rasterizer,
+    //the capabilities of devices seen before are read from disk instead of queried again
+    class VulkanDeviceSelector {
+
+    public:
+
+        //best first, unusable devices left out, a matching preference goes first no matter its score
+        std::vector<DeviceCandidate> rank(VkInstance instance, bool needsSwapchain, const std::string& preference);
+
+        //writes what was queried this run, so the next one can skip it
+        void save() const;
+
+        constexpr static uint32_t MAGIC = 0x44434643;//"CFCD"
+        constexpr static uint32_t VERSION = 2;
+        constexpr static uint32_t MAX_CACHED_DEVICES = 16;
+
+        //overrides a preference set in code, a device name, part of one, or its uuid
+        constexpr static const char* OVERRIDE_VARIABLE = "COREFUL_GPU";
+
+    private:
+
+        std::vector<DeviceCapabilities> m_cache;
+        bool m_cacheChanged = false;
+        std::filesystem::path m_path;
+
+        void load();
+        DeviceCapabilities query(VkPhysicalDevice device);
+
+        static int64_t score(const DeviceCapabilities& capabilities, bool needsSwapchain);
+        static bool matches(const DeviceCapabilities& capabilities, const std::string& preference);
+        static std::string formatUUID(const uint8_t uuid[VK_UUID_SIZE]);
+        static const char* typeName(uint32_t type);
+
+    };
+
+}
@@ -0,0 +1,161 @@
+
+#include "VulkanGpuProfiler.h"
+
+#include <stdexcept>
+#include <thread>
+
+#include "util/Logger.h"
+
+namespace Coreful::renderer::vulkan {
+
+    void VulkanGpuProfiler::init(VkPhysicalDevice physicalDevice, const VkDevice device, const uint32_t queueFamily, const uint32_t frameCount) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+        const uint32_t validBits = queueFamilies[queueFamily].timestampValidBits;
+        if (validBits == 0 || properties.limits.timestampPeriod == 0.0f) {
+            log(Logger::LogType::Warn, "Queue does not support timestamps, gpu profiling disabled");
+            return;
+        }
+
+        m_timestampPeriod = properties.limits.timestampPeriod;
+        m_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = MAX_SCOPES * 2;//begin and end
+
+        m_frames.resize(frameCount);
+        for (auto& frame : m_frames) {
+            if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &frame.queryPool) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create timestamp query pool!");
+            }
+            frame.names.reserve(MAX_SCOPES);
+        }
+
+        m_enabled = true;
+        LOG_DEBUGF("Gpu Profiler Created! ({} ns per tick)", m_timestampPeriod);
+    }
+
+    void VulkanGpuProfiler::cleanup(const VkDevice device) {
+        for (const auto& frame : m_frames) {
+            vkDestroyQueryPool(device, frame.queryPool, nullptr);
+        }
+        m_frames.clear();
+        m_enabled = false;
+    }
+
+    void VulkanGpuProfiler::collect(const VkDevice device, const uint32_t frameIndex) {
+        if (!m_enabled) return;
+
+        FrameQueries& frame = m_frames[frameIndex];
+        if (!frame.pending) return;
+        frame.pending = false;
+
+        if (frame.names.empty()) return;
+
+        std::vector<uint64_t> timestamps(frame.names.size() * 2);
+        const VkResult result = vkGetQueryPoolResults(device, frame.queryPool, 0, static_cast<uint32_t>(timestamps.size()),
+            timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+        //the frame has finished, anything but success means the frame was never submitted
+        if (result != VK_SUCCESS) return;
+
+        publish(frame, timestamps);
+    }
+
+    void VulkanGpuProfiler::reset(VkCommandBuffer commandBuffer, const uint32_t frameIndex) {
+        if (!m_enabled) return;
+
+        m_recordingFrame = frameIndex;
+        FrameQueries& frame = m_frames[frameIndex];
+        frame.names.clear();
+        frame.pending = true;
+
+        vkCmdResetQueryPool(commandBuffer, frame.queryPool, 0, MAX_SCOPES * 2);
+    }
+
+    uint32_t VulkanGpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char* name) {
+        if (!m_enabled) return INVALID_SCOPE;
+
+        FrameQueries& frame = m_frames[m_recordingFrame];
+        if (frame.names.size() == MAX_SCOPES) return INVALID_SCOPE;
+
+        const auto scope = static_cast<uint32_t>(frame.names.size());
+        frame.names.push_back(name);
+
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.queryPool, scope * 2);
+        return scope;
+    }
+
+    void VulkanGpuProfiler::endScope(VkCommandBuffer commandBuffer, const uint32_t scope) {
+        if (scope == INVALID_SCOPE) return;
+
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_frames[m_recordingFrame].queryPool, scope * 2 + 1);
+    }
+
+    bool VulkanGpuProfiler::getFrameTimings(const uint32_t framesAgo, GpuFrameTimings& timings) const {
+        const uint64_t published = m_published.load(std::memory_order_acquire);
+        if (framesAgo >= published || framesAgo >= HISTORY_SIZE) return false;
+
+        const uint64_t frameNumber = published - 1 - framesAgo;
+        const HistorySlot& slot = m_history[frameNumber % HISTORY_SIZE];
+
+        for (uint32_t attempt = 0; attempt < READ_ATTEMPTS; attempt++) {
+            if (attempt > 0) std::this_thread::yield();//let the writer finish instead of spinning against it
+
+            const uint64_t before = slot.sequence.load(std::memory_order_acquire);
+            if (before & 1) continue;//being written right now
+
+            const uint64_t frame = slot.frame.load(std::memory_order_relaxed);
+            const uint32_t scopeCount = slot.scopeCount.load(std::memory_order_relaxed);
+
+            timings.scopes.resize(scopeCount);
+            for (uint32_t i = 0; i < scopeCount; i++) {
+                timings.scopes[i].name = slot.names[i].load(std::memory_order_relaxed);
+                timings.scopes[i].milliseconds = slot.milliseconds[i].load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != before) continue;
+
+            //the slot was reused by a newer frame while we were looking
+            if (frame != frameNumber) return false;
+
+            timings.frame = frame;
+            return true;
+        }
+
+        return false;
+    }
+
+    void VulkanGpuProfiler::publish(const FrameQueries& frame, const std::vector<uint64_t>& timestamps) {
+        const uint64_t frameNumber = m_published.load(std::memory_order_relaxed);
+        HistorySlot& slot = m_history[frameNumber % HISTORY_SIZE];
+
+        const uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        const auto scopeCount = static_cast<uint32_t>(frame.names.size());
+        slot.frame.store(frameNumber, std::memory_order_relaxed);
+        slot.scopeCount.store(scopeCount, std::memory_order_relaxed);
+
+        for (uint32_t i = 0; i < scopeCount; i++) {
+            //masked so a counter wrapping inside a scope still gives the right difference
+            const uint64_t ticks = (timestamps[i * 2 + 1] - timestamps[i * 2]) & m_timestampMask;
+            slot.names[i].store(frame.names[i], std::memory_order_relaxed);
+            slot.milliseconds[i].store(static_cast<double>(ticks) * m_timestampPeriod / 1e6, std::memory_order_relaxed);
+        }
+
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+        m_published.store(frameNumber + 1, std::memory_order_release);
+    }
+
+}
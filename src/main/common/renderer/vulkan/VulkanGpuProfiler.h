@@ -0,0 +1,90 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "renderer/GpuTimings.h"
+
+namespace Coreful::renderer::vulkan {
+
+    //timestamp queries around named scopes of a frame's command buffer, one query pool per frame in flight
+    class VulkanGpuProfiler {
+
+    public:
+
+        void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t frameCount);
+        void cleanup(VkDevice device);
+
+        //the frame has finished on the gpu, its timestamps are read back and published
+        void collect(VkDevice device, uint32_t frameIndex);
+        //recorded first thing in the frame's command buffer, outside any render pass
+        void reset(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+        //name has to outlive the profiler, string literals are expected
+        uint32_t beginScope(VkCommandBuffer commandBuffer, const char* name);
+        void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+        //0 is the latest finished frame, safe to call from any thread, false too when the frame kept being rewritten
+        bool getFrameTimings(uint32_t framesAgo, GpuFrameTimings& timings) const;
+
+        [[nodiscard]] bool isEnabled() const {return m_enabled;}
+
+        constexpr static uint32_t MAX_SCOPES = 32;
+        constexpr static uint32_t HISTORY_SIZE = 64;
+        constexpr static uint32_t INVALID_SCOPE = UINT32_MAX;
+        constexpr static uint32_t READ_ATTEMPTS = 8;//publishing a slot is only a few stores, a reader that keeps losing gives up
+
+    private:
+
+        struct FrameQueries {
+            VkQueryPool queryPool = VK_NULL_HANDLE;
+            std::vector<const char*> names;
+            bool pending = false;//recorded, not collected yet
+        };
+
+        //seqlock, odd sequence while the render thread writes it
+        struct alignas(64) HistorySlot {
+            std::atomic<uint64_t> sequence{0};
+            std::atomic<uint64_t> frame{0};
+            std::atomic<uint32_t> scopeCount{0};
+            std::array<std::atomic<const char*>, MAX_SCOPES> names{};
+            std::array<std::atomic<double>, MAX_SCOPES> milliseconds{};
+        };
+
+        bool m_enabled = false;
+        double m_timestampPeriod = 1.0;//nanoseconds per tick
+        uint64_t m_timestampMask = ~0ull;
+
+        std::vector<FrameQueries> m_frames;
+        uint32_t m_recordingFrame = 0;
+
+        std::array<HistorySlot, HISTORY_SIZE> m_history;
+        std::atomic<uint64_t> m_published{0};
+
+        void publish(const FrameQueries& frame, const std::vector<uint64_t>& timestamps);
+
+    };
+
+    //times everything recorded into commandBuffer while it is alive
+    class GpuScope {
+
+    public:
+
+        GpuScope(VulkanGpuProfiler& profiler, VkCommandBuffer commandBuffer, const char* name)
+        : m_profiler(profiler), m_commandBuffer(commandBuffer), m_scope(profiler.beginScope(commandBuffer, name)) {}
+
+        ~GpuScope() {m_profiler.endScope(m_commandBuffer, m_scope);}
+
+        GpuScope(const GpuScope&) = delete;
+        GpuScope& operator=(const GpuScope&) = delete;
+
+    private:
+
+        VulkanGpuProfiler& m_profiler;
+        VkCommandBuffer m_commandBuffer;
+        uint32_t m_scope;
+
+    };
+
+}
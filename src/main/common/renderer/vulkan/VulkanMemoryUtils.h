@@ -0,0 +1,23 @@
+#pragma once
+#include <stdexcept>
+#include <vulkan/vulkan.h>
+
+namespace Coreful::renderer::vulkan {
+
+    //first memory type allowed by typeBits that has required | preferred, falling back to just required
+    inline uint32_t findMemoryType(
+        const VkPhysicalDeviceMemoryProperties& memoryProperties,
+        const uint32_t typeBits,
+        const VkMemoryPropertyFlags required,
+        const VkMemoryPropertyFlags preferred = 0) {
+
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+            const VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+            if (typeBits & (1u << i) && (flags & (required | preferred)) == (required | preferred)) return i;
+        }
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+            if (typeBits & (1u << i) && (memoryProperties.memoryTypes[i].propertyFlags & required) == required) return i;
+        }
+        throw std::runtime_error("Failed to find a suitable memory type!");
+    }
+}
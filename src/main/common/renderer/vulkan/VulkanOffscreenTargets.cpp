@@ -0,0 +1,94 @@
+
+#include "VulkanOffscreenTargets.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "util/Logger.h"
+
+namespace Coreful::renderer::vulkan {
+
+    void VulkanOffscreenTargets::init(
+        VulkanAllocator& allocator,
+        const uint32_t width, const uint32_t height,
+        const VkFormat format,
+        const uint32_t targetCount) {
+
+        m_allocator = &allocator;
+        m_extent = {width, height};
+        m_imageFormat = format;
+
+        const VkDevice device = m_allocator->getDevice();
+
+        m_targets.resize(targetCount);
+        m_imageViews.resize(targetCount);
+
+        for (uint32_t i = 0; i < targetCount; i++) {
+            OffscreenTarget& target = m_targets[i];
+
+            //color image
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.format = m_imageFormat;
+            imageInfo.extent = {width, height, 1};
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            target.imageAllocation = m_allocator->createImage(imageInfo, MemoryUsage::GpuOnly, target.image);
+
+            VkImageViewCreateInfo viewCreateInfo{};
+            viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewCreateInfo.image = target.image;
+            viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewCreateInfo.format = m_imageFormat;
+            viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            viewCreateInfo.subresourceRange.baseMipLevel = 0;
+            viewCreateInfo.subresourceRange.levelCount = 1;
+            viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+            viewCreateInfo.subresourceRange.layerCount = 1;
+
+            if (VkResult result = vkCreateImageView(device, &viewCreateInfo, nullptr, &target.imageView); result != VK_SUCCESS) {
+                log(Logger::LogType::Error, "vkCreateImageView failed! with code: ", result);
+                throw std::runtime_error("Failed to create offscreen image view!");
+            }
+            m_imageViews[i] = target.imageView;
+
+            //readback buffer
+            VkBufferCreateInfo bufferInfo{};
+            bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size = getImageSize();
+            bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            target.readbackAllocation = m_allocator->createBuffer(bufferInfo, MemoryUsage::GpuToCpu, target.readbackBuffer);
+        }
+
+        LOG_DEBUG("Offscreen Targets Created!");
+    }
+
+    void VulkanOffscreenTargets::cleanup() {
+        for (auto& target : m_targets) {
+            vkDestroyImageView(m_allocator->getDevice(), target.imageView, nullptr);
+            m_allocator->destroyImage(target.image, target.imageAllocation);
+            m_allocator->destroyBuffer(target.readbackBuffer, target.readbackAllocation);
+        }
+        m_targets.clear();
+        m_imageViews.clear();
+    }
+
+    void VulkanOffscreenTargets::readPixels(const uint32_t targetIndex, std::vector<uint8_t>& pixels) const {
+        const OffscreenTarget& target = m_targets[targetIndex];
+
+        m_allocator->invalidate(target.readbackAllocation);
+
+        pixels.resize(getImageSize());
+        std::memcpy(pixels.data(), target.readbackAllocation.mapped, pixels.size());
+    }
+
+}
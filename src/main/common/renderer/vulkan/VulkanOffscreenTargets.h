@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "VulkanAllocator.h"
+
+namespace Coreful::renderer::vulkan {
+
+    //a device-local color image plus a host-visible buffer it gets copied into for readback
+    struct OffscreenTarget {
+        VkImage image = VK_NULL_HANDLE;
+        Allocation imageAllocation;
+        VkImageView imageView = VK_NULL_HANDLE;
+
+        VkBuffer readbackBuffer = VK_NULL_HANDLE;
+        Allocation readbackAllocation;//stays mapped
+    };
+
+    //stands in for the swapchain when the renderer runs without a surface
+    class VulkanOffscreenTargets {
+
+    public:
+
+        void init(
+            VulkanAllocator& allocator,
+            uint32_t width, uint32_t height,
+            VkFormat format,
+            uint32_t targetCount
+            );
+
+        void cleanup();
+
+        //copies the tightly packed pixels of a finished target into pixels, the target's frame must have completed
+        void readPixels(uint32_t targetIndex, std::vector<uint8_t>& pixels) const;
+
+        [[nodiscard]] VkFormat getImageFormat() const {return m_imageFormat;}
+        [[nodiscard]] uint32_t getImageCount() const {return static_cast<uint32_t>(m_targets.size());}
+        [[nodiscard]] VkExtent2D getExtent() const {return m_extent;}
+        [[nodiscard]] const std::vector<VkImageView>& getImageViews() const {return m_imageViews;}
+        [[nodiscard]] const OffscreenTarget& getTarget(const uint32_t index) const {return m_targets[index];}
+        [[nodiscard]] VkDeviceSize getImageSize() const {return static_cast<VkDeviceSize>(m_extent.width) * m_extent.height * BYTES_PER_PIXEL;}
+
+        constexpr static uint32_t BYTES_PER_PIXEL = 4;
+
+    private:
+
+        VulkanAllocator* m_allocator = nullptr;
+        VkFormat m_imageFormat{};
+        VkExtent2D m_extent{};
+        std::vector<OffscreenTarget> m_targets;
+        std::vector<VkImageView> m_imageViews;
+
+    };
+
+}
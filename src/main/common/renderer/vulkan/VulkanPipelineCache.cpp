@@ -0,0 +1,160 @@
+
+#include "VulkanPipelineCache.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "util/Logger.h"
+
+namespace Coreful::renderer::vulkan {
+
+    void VulkanPipelineCache::init(VkPhysicalDevice physicalDevice, const VkDevice device) {
+        vkGetPhysicalDeviceProperties(physicalDevice, &m_properties);
+        m_path = getCacheDirectory() / "pipeline_cache.bin";
+
+        const std::vector<char> data = load();
+
+        VkPipelineCacheCreateInfo cacheInfo{};
+        cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        cacheInfo.initialDataSize = data.size();
+        cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+        if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &m_pipelineCache) != VK_SUCCESS) {
+            //the driver rejected the data after all, start over with an empty cache
+            log(Logger::LogType::Warn, "Pipeline cache data rejected by the driver, starting empty");
+            cacheInfo.initialDataSize = 0;
+            cacheInfo.pInitialData = nullptr;
+
+            if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &m_pipelineCache) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create pipeline cache!");
+            }
+        }
+
+        LOG_DEBUGF("Pipeline Cache Created! ({} bytes loaded)", data.size());
+    }
+
+    void VulkanPipelineCache::cleanup(const VkDevice device) {
+        vkDestroyPipelineCache(device, m_pipelineCache, nullptr);
+        m_pipelineCache = VK_NULL_HANDLE;
+    }
+
+    void VulkanPipelineCache::save(const VkDevice device) const {
+        if (m_pipelineCache == VK_NULL_HANDLE) return;
+
+        size_t dataSize = 0;
+        vkGetPipelineCacheData(device, m_pipelineCache, &dataSize, nullptr);
+
+        std::vector<char> data(dataSize);
+        if (vkGetPipelineCacheData(device, m_pipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+            log(Logger::LogType::Warn, "Failed to read pipeline cache data, not saving");
+            return;
+        }
+        data.resize(dataSize);
+
+        PipelineCacheHeader header{};
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.vendorID = m_properties.vendorID;
+        header.deviceID = m_properties.deviceID;
+        std::memcpy(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE);
+        header.dataSize = dataSize;
+        header.checksum = checksum(data.data(), data.size());
+
+        std::error_code error;
+        std::filesystem::create_directories(m_path.parent_path(), error);
+
+        std::filesystem::path tempPath = m_path;
+        tempPath += ".tmp";
+
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(data.data(), static_cast<std::streamsize>(data.size()));
+
+            if (!file) {
+                log(Logger::LogType::Warn, "Failed to write pipeline cache to ", tempPath.string());
+                file.close();
+                std::filesystem::remove(tempPath, error);
+                return;
+            }
+        }
+
+        //rename replaces the old cache in one step
+        std::filesystem::rename(tempPath, m_path, error);
+        if (error) {
+            log(Logger::LogType::Warn, "Failed to replace pipeline cache: ", error.message());
+            std::filesystem::remove(tempPath, error);
+            return;
+        }
+
+        LOG_DEBUGF("Pipeline Cache Saved! ({} bytes)", dataSize);
+    }
+
+    std::vector<char> VulkanPipelineCache::load() const {
+        std::ifstream file(m_path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) return {};
+
+        const std::streamsize fileSize = file.tellg();
+        if (fileSize < static_cast<std::streamsize>(sizeof(PipelineCacheHeader))) {
+            log(Logger::LogType::Warn, "Pipeline cache file is truncated, ignoring it");
+            return {};
+        }
+        file.seekg(0);
+
+        PipelineCacheHeader header{};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        std::vector<char> data(static_cast<size_t>(fileSize) - sizeof(header));
+        file.read(data.data(), static_cast<std::streamsize>(data.size()));
+
+        if (!file || !validate(header, data.data(), data.size())) return {};
+        return data;
+    }
+
+    bool VulkanPipelineCache::validate(const PipelineCacheHeader& header, const char* data, const size_t size) const {
+        if (header.magic != MAGIC || header.version != VERSION) {
+            log(Logger::LogType::Warn, "Pipeline cache has an unknown format, ignoring it");
+            return false;
+        }
+        if (header.vendorID != m_properties.vendorID || header.deviceID != m_properties.deviceID
+            || std::memcmp(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+            log(Logger::LogType::Info, "Pipeline cache was written by another gpu or driver, ignoring it");
+            return false;
+        }
+        if (header.dataSize != size || header.checksum != checksum(data, size)) {
+            log(Logger::LogType::Warn, "Pipeline cache is corrupted, ignoring it");
+            return false;
+        }
+        return true;
+    }
+
+    std::filesystem::path VulkanPipelineCache::getCacheDirectory() {
+#ifdef _WIN32
+        if (const char* localAppData = std::getenv("LOCALAPPDATA")) {
+            return std::filesystem::path(localAppData) / "Coreful";
+        }
+#else
+        if (const char* xdgCache = std::getenv("XDG_CACHE_HOME"); xdgCache && *xdgCache) {
+            return std::filesystem::path(xdgCache) / "coreful";
+        }
+        if (const char* home = std::getenv("HOME")) {
+            return std::filesystem::path(home) / ".cache" / "coreful";
+        }
+#endif
+        std::error_code error;
+        return std::filesystem::temp_directory_path(error) / "coreful";
+    }
+
+    uint64_t VulkanPipelineCache::checksum(const char* data, const size_t size) {
+        //64-bit FNV-1a
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < size; i++) {
+            hash ^= static_cast<uint8_t>(data[i]);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+}
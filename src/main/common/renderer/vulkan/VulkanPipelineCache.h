@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Coreful::renderer::vulkan {
+
+    //prefixed to the driver's cache data, a file from another gpu or driver is thrown away instead of handed to vulkan
+    struct PipelineCacheHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t checksum;//of the data following the header
+    };
+
+    static_assert(sizeof(PipelineCacheHeader) == 48, "PipelineCacheHeader must not contain padding");
+
+    //VkPipelineCache that is loaded from disk on init and written back on save
+    class VulkanPipelineCache {
+
+    public:
+
+        void init(VkPhysicalDevice physicalDevice, VkDevice device);
+        void cleanup(VkDevice device);
+
+        //writes to a temporary file first and renames it over the old one, so a crash never leaves a torn cache
+        void save(VkDevice device) const;
+
+        [[nodiscard]] VkPipelineCache get() const {return m_pipelineCache;}
+
+        constexpr static uint32_t MAGIC = 0x50434643;//"CFCP"
+        constexpr static uint32_t VERSION = 1;
+
+        //shared with the other on-disk caches
+        static std::filesystem::path getCacheDirectory();
+        static uint64_t checksum(const char* data, size_t size);
+
+    private:
+
+        VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+        VkPhysicalDeviceProperties m_properties{};
+        std::filesystem::path m_path;
+
+        [[nodiscard]] std::vector<char> load() const;
+        [[nodiscard]] bool validate(const PipelineCacheHeader& header, const char* data, size_t size) const;
+
+    };
+
+}
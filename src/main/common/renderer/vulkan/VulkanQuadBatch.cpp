@@ -0,0 +1,116 @@
+
+#include "VulkanQuadBatch.h"
+
+#include <cstddef>
+#include <cstring>
+
+#include "util/Logger.h"
+
+namespace Coreful::renderer::vulkan {
+
+    void VulkanQuadBatch::init(VulkanAllocator& allocator, const uint32_t frameCount) {
+        m_allocator = &allocator;
+
+        m_frames.resize(frameCount);
+        for (auto& frame : m_frames) allocate(frame, INITIAL_CAPACITY);
+
+        LOG_DEBUG("Quad Batch Created!");
+    }
+
+    void VulkanQuadBatch::cleanup() {
+        for (auto& frame : m_frames) release(frame);
+        m_frames.clear();
+    }
+
+    void VulkanQuadBatch::begin(const uint32_t frameIndex) {
+        m_frameIndex = frameIndex;
+        m_count = 0;
+    }
+
+    void VulkanQuadBatch::push(const QuadInstance& quad) {
+        InstanceBuffer& frame = m_frames[m_frameIndex];
+        if (m_count == frame.capacity) grow(frame);
+
+        frame.mapped[m_count++] = quad;
+    }
+
+    void VulkanQuadBatch::record(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const VkExtent2D extent) const {
+        record(commandBuffer, pipelineLayout, extent, 0, m_count);//the whole frame in one call
+    }
+
+    void VulkanQuadBatch::record(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const VkExtent2D extent,
+                                 const uint32_t firstInstance, const uint32_t instanceCount) const {
+        if (instanceCount == 0) return;
+
+        const float screenSize[2] = {static_cast<float>(extent.width), static_cast<float>(extent.height)};
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(screenSize), screenSize);
+
+        constexpr VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_frames[m_frameIndex].buffer, &offset);
+
+        vkCmdDraw(commandBuffer, VERTICES_PER_QUAD, instanceCount, 0, firstInstance);
+    }
+
+    VkVertexInputBindingDescription VulkanQuadBatch::getBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(QuadInstance);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+        return bindingDescription;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> VulkanQuadBatch::getAttributeDescriptions() {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions(3);
+
+        //x, y, width, height
+        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].binding = 0;
+        attributeDescriptions[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        attributeDescriptions[0].offset = offsetof(QuadInstance, x);
+
+        //r, g, b, a
+        attributeDescriptions[1].location = 1;
+        attributeDescriptions[1].binding = 0;
+        attributeDescriptions[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        attributeDescriptions[1].offset = offsetof(QuadInstance, r);
+
+        //texture index
+        attributeDescriptions[2].location = 2;
+        attributeDescriptions[2].binding = 0;
+        attributeDescriptions[2].format = VK_FORMAT_R32_UINT;
+        attributeDescriptions[2].offset = offsetof(QuadInstance, textureIndex);
+
+        return attributeDescriptions;
+    }
+
+    void VulkanQuadBatch::allocate(InstanceBuffer& instanceBuffer, const uint32_t capacity) const {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = static_cast<VkDeviceSize>(capacity) * sizeof(QuadInstance);
+        bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        //coherent and already mapped, so no flush per frame
+        instanceBuffer.allocation = m_allocator->createBuffer(bufferInfo, MemoryUsage::CpuToGpu, instanceBuffer.buffer);
+        instanceBuffer.mapped = static_cast<QuadInstance*>(instanceBuffer.allocation.mapped);
+        instanceBuffer.capacity = capacity;
+    }
+
+    void VulkanQuadBatch::release(InstanceBuffer& instanceBuffer) const {
+        m_allocator->destroyBuffer(instanceBuffer.buffer, instanceBuffer.allocation);
+        instanceBuffer = {};
+    }
+
+    void VulkanQuadBatch::grow(InstanceBuffer& instanceBuffer) const {
+        //safe to replace, the gpu finished with this frame before begin() was called
+        InstanceBuffer grown;
+        allocate(grown, instanceBuffer.capacity * 2);
+        std::memcpy(grown.mapped, instanceBuffer.mapped, static_cast<size_t>(m_count) * sizeof(QuadInstance));
+
+        release(instanceBuffer);
+        instanceBuffer = grown;
+
+        LOG_DEBUGF("Quad Batch grown to {} instances", instanceBuffer.capacity);
+    }
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "VulkanAllocator.h"
+#include "renderer/QuadInstance.h"
+
+namespace Coreful::renderer::vulkan {
+
+    //collects every quad of a frame into a persistently mapped instance buffer and draws them with one instanced call
+    class VulkanQuadBatch {
+
+    public:
+
+        void init(VulkanAllocator& allocator, uint32_t frameCount);
+        void cleanup();
+
+        //starts filling the buffer of frameIndex, the gpu must be done with that frame
+        void begin(uint32_t frameIndex);
+        void push(const QuadInstance& quad);
+
+        void record(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VkExtent2D extent) const;
+        //only instances [firstInstance, firstInstance + instanceCount), lets several command buffers share one batch
+        void record(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VkExtent2D extent,
+                    uint32_t firstInstance, uint32_t instanceCount) const;
+
+        [[nodiscard]] uint32_t getCount() const {return m_count;}
+
+        static VkVertexInputBindingDescription getBindingDescription();
+        static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+
+        constexpr static uint32_t INITIAL_CAPACITY = 1024;
+        constexpr static uint32_t VERTICES_PER_QUAD = 6;
+
+    private:
+
+        struct InstanceBuffer {
+            VkBuffer buffer = VK_NULL_HANDLE;
+            Allocation allocation;
+            QuadInstance* mapped = nullptr;
+            uint32_t capacity = 0;
+        };
+
+        VulkanAllocator* m_allocator = nullptr;
+
+        std::vector<InstanceBuffer> m_frames;
+        uint32_t m_frameIndex = 0;
+        uint32_t m_count = 0;
+
+        void allocate(InstanceBuffer& instanceBuffer, uint32_t capacity) const;
+        void release(InstanceBuffer& instanceBuffer) const;
+        void grow(InstanceBuffer& instanceBuffer) const;
+
+    };
+
+}
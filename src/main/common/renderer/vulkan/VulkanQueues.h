@@ -7,6 +7,7 @@ namespace Coreful::renderer::vulkan {
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        std::optional<uint32_t> transferFamily;//only set for a family without graphics, uploads use the graphics queue otherwise
 
         [[nodiscard]] bool isComplete() const {
             return graphicsFamily.has_value() && presentFamily.has_value();
@@ -0,0 +1,473 @@
+
+#include "VulkanRenderGraph.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include "util/Logger.h"
+
+namespace Coreful::renderer::vulkan {
+
+    void VulkanRenderGraph::init(VulkanAllocator& allocator, const PFN_vkCmdPipelineBarrier2 pipelineBarrier2,
+                                 std::function<void(std::function<void()>)> retire) {
+        m_allocator = &allocator;
+        m_pipelineBarrier2 = pipelineBarrier2;
+        m_retire = std::move(retire);
+    }
+
+    void VulkanRenderGraph::cleanup() {
+        reset();
+        destroyTransientImages(true);
+    }
+
+    void VulkanRenderGraph::reset() {
+        m_resources.clear();
+        m_passes.clear();
+        m_finalImageBarriers.clear();
+        m_finalMemoryBarrier = {};
+    }
+
+    RenderGraphResource VulkanRenderGraph::importImage(const char* name, const VkImage image, const VkImageView imageView, const ResourceState& state) {
+        Resource resource;
+        resource.name = name;
+        resource.image = image;
+        resource.imageView = imageView;
+        resource.initialState = state;
+        m_resources.push_back(resource);
+        return static_cast<RenderGraphResource>(m_resources.size() - 1);
+    }
+
+    RenderGraphResource VulkanRenderGraph::importBuffer(const char* name, const VkBuffer buffer, const ResourceState& state) {
+        Resource resource;
+        resource.name = name;
+        resource.isImage = false;
+        resource.buffer = buffer;
+        resource.initialState = state;
+        m_resources.push_back(resource);
+        return static_cast<RenderGraphResource>(m_resources.size() - 1);
+    }
+
+    RenderGraphResource VulkanRenderGraph::createImage(const char* name, const TransientImageDesc& desc) {
+        if (desc.format == VK_FORMAT_UNDEFINED || desc.extent.width == 0 || desc.extent.height == 0) {
+            throw std::runtime_error("Transient render graph image needs a format and a size!");
+        }
+
+        Resource resource;
+        resource.name = name;
+        resource.transient = true;
+        resource.desc = desc;
+        resource.aspect = getAspect(desc.format);
+        m_resources.push_back(resource);
+        return static_cast<RenderGraphResource>(m_resources.size() - 1);
+    }
+
+    void VulkanRenderGraph::exportResource(const RenderGraphResource resource, const ResourceState& state) {
+        m_resources[resource].exported = true;
+        m_resources[resource].finalState = state;
+    }
+
+    RenderGraphPass VulkanRenderGraph::addPass(const char* name, std::function<void(VkCommandBuffer)> execute) {
+        Pass pass;
+        pass.name = name;
+        pass.execute = std::move(execute);
+        m_passes.push_back(std::move(pass));
+        return static_cast<RenderGraphPass>(m_passes.size() - 1);
+    }
+
+    void VulkanRenderGraph::read(const RenderGraphPass pass, const RenderGraphResource resource, const ResourceState& state) {
+        use(pass, resource, state, true, false, VK_IMAGE_LAYOUT_UNDEFINED);
+    }
+
+    void VulkanRenderGraph::write(const RenderGraphPass pass, const RenderGraphResource resource, const ResourceState& state,
+                                  const VkImageLayout layoutAfter) {
+        use(pass, resource, state, false, true, layoutAfter);
+    }
+
+    void VulkanRenderGraph::use(const RenderGraphPass pass, const RenderGraphResource resource, const ResourceState& state,
+                                const bool reads, const bool writes, const VkImageLayout layoutAfter) {
+        //reading and writing the same resource is one access, a pass can't be in two layouts at once
+        for (Access& access : m_passes[pass].accesses) {
+            if (access.resource != resource) continue;
+            if (access.state.layout != state.layout) {
+                throw std::runtime_error("Render graph pass uses an image in two layouts!");
+            }
+            access.state.stage |= state.stage;
+            access.state.access |= state.access;
+            access.reads |= reads;
+            access.writes |= writes;
+            if (writes) access.layoutAfter = layoutAfter;
+            return;
+        }
+
+        m_passes[pass].accesses.push_back({resource, state, reads, writes, layoutAfter});
+    }
+
+    void VulkanRenderGraph::compile() {
+        cull();
+        placeTransientImages();
+        buildBarriers();
+    }
+
+    void VulkanRenderGraph::execute(VkCommandBuffer commandBuffer, VulkanGpuProfiler& profiler) const {
+        for (const Pass& pass : m_passes) {
+            if (pass.culled) continue;
+
+            recordBarriers(commandBuffer, pass.imageBarriers, pass.memoryBarrier);
+
+            GpuScope passScope(profiler, commandBuffer, pass.name);
+            pass.execute(commandBuffer);
+        }
+
+        recordBarriers(commandBuffer, m_finalImageBarriers, m_finalMemoryBarrier);
+    }
+
+    VkDeviceSize VulkanRenderGraph::getTransientMemorySize() const {
+        VkDeviceSize size = 0;
+        for (const MemorySlot& slot : m_memorySlots) size += slot.allocation.size;
+        return size;
+    }
+
+    VkImageAspectFlags VulkanRenderGraph::getAspect(const VkFormat format) {
+        switch (format) {
+            case VK_FORMAT_D16_UNORM:
+            case VK_FORMAT_X8_D24_UNORM_PACK32:
+            case VK_FORMAT_D32_SFLOAT:
+                return VK_IMAGE_ASPECT_DEPTH_BIT;
+            case VK_FORMAT_S8_UINT:
+                return VK_IMAGE_ASPECT_STENCIL_BIT;
+            case VK_FORMAT_D16_UNORM_S8_UINT:
+            case VK_FORMAT_D24_UNORM_S8_UINT:
+            case VK_FORMAT_D32_SFLOAT_S8_UINT:
+                return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+            default:
+                return VK_IMAGE_ASPECT_COLOR_BIT;
+        }
+    }
+
+    void VulkanRenderGraph::cull() {
+        //walking backwards, a pass survives if it writes something a later surviving pass or an export needs
+        std::vector<bool> needed(m_resources.size());
+        for (size_t i = 0; i < m_resources.size(); i++) needed[i] = m_resources[i].exported;
+
+        for (auto pass = m_passes.rbegin(); pass != m_passes.rend(); ++pass) {
+            pass->culled = std::ranges::none_of(pass->accesses, [&needed](const Access& access) {
+                return access.writes && needed[access.resource];
+            });
+            if (pass->culled) continue;
+
+            for (const Access& access : pass->accesses) {
+                if (access.reads) needed[access.resource] = true;
+            }
+        }
+
+        for (Resource& resource : m_resources) {
+            resource.firstPass = UINT32_MAX;
+            resource.lastPass = 0;
+        }
+        for (uint32_t i = 0; i < m_passes.size(); i++) {
+            if (m_passes[i].culled) continue;
+            for (const Access& access : m_passes[i].accesses) {
+                Resource& resource = m_resources[access.resource];
+                resource.firstPass = std::min(resource.firstPass, i);
+                resource.lastPass = std::max(resource.lastPass, i);
+            }
+        }
+    }
+
+    void VulkanRenderGraph::placeTransientImages() {
+        //only images a surviving pass touches get memory
+        std::vector<RenderGraphResource> used;
+        std::vector<TransientImage> wanted;
+        for (uint32_t i = 0; i < m_resources.size(); i++) {
+            const Resource& resource = m_resources[i];
+            if (!resource.transient || resource.firstPass == UINT32_MAX) continue;
+
+            TransientImage image;
+            image.desc = resource.desc;
+            image.firstPass = resource.firstPass;
+            image.lastPass = resource.lastPass;
+            wanted.push_back(image);
+            used.push_back(i);
+        }
+
+        //usually the same graph as last frame, then the same images can be handed out again
+        const bool unchanged = std::ranges::equal(wanted, m_transientImages, [](const TransientImage& a, const TransientImage& b) {
+            return a.desc == b.desc && a.firstPass == b.firstPass && a.lastPass == b.lastPass;
+        });
+
+        if (!unchanged) {
+            destroyTransientImages(false);
+
+            const VkDevice device = m_allocator->getDevice();
+            std::vector<VkMemoryRequirements> requirements(wanted.size());
+
+            for (size_t i = 0; i < wanted.size(); i++) {
+                VkImageCreateInfo imageInfo{};
+                imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+                imageInfo.imageType = VK_IMAGE_TYPE_2D;
+                imageInfo.format = wanted[i].desc.format;
+                imageInfo.extent = {wanted[i].desc.extent.width, wanted[i].desc.extent.height, 1};
+                imageInfo.mipLevels = 1;
+                imageInfo.arrayLayers = 1;
+                imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+                imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+                imageInfo.usage = wanted[i].desc.usage;
+                imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+                imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+                if (vkCreateImage(device, &imageInfo, nullptr, &wanted[i].image) != VK_SUCCESS) {
+                    throw std::runtime_error("Failed to create transient image!");
+                }
+                vkGetImageMemoryRequirements(device, wanted[i].image, &requirements[i]);
+            }
+
+            //in order of first use, each image takes the slot it grows the least whose last user is done before it starts
+            std::vector<size_t> order(wanted.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::ranges::stable_sort(order, [&wanted](const size_t a, const size_t b) {return wanted[a].firstPass < wanted[b].firstPass;});
+
+            for (const size_t i : order) {
+                const VkMemoryRequirements& required = requirements[i];
+                auto best = static_cast<uint32_t>(m_memorySlots.size());
+                VkDeviceSize bestGrowth = ~VkDeviceSize{0};
+
+                for (uint32_t s = 0; s < m_memorySlots.size(); s++) {
+                    const MemorySlot& slot = m_memorySlots[s];
+                    if (slot.lastPass >= wanted[i].firstPass) continue;
+                    if (!(slot.requirements.memoryTypeBits & required.memoryTypeBits)) continue;
+
+                    const VkDeviceSize growth = required.size > slot.requirements.size ? required.size - slot.requirements.size : 0;
+                    if (growth < bestGrowth) {
+                        best = s;
+                        bestGrowth = growth;
+                    }
+                }
+
+                if (best == m_memorySlots.size()) {
+                    MemorySlot slot;
+                    slot.requirements = required;
+                    m_memorySlots.push_back(slot);
+                }else {
+                    VkMemoryRequirements& merged = m_memorySlots[best].requirements;
+                    merged.size = std::max(merged.size, required.size);
+                    merged.alignment = std::max(merged.alignment, required.alignment);
+                    merged.memoryTypeBits &= required.memoryTypeBits;
+                }
+                m_memorySlots[best].lastPass = wanted[i].lastPass;
+                wanted[i].slot = best;
+            }
+
+            for (MemorySlot& slot : m_memorySlots) {
+                slot.allocation = m_allocator->allocateImageMemory(slot.requirements, MemoryUsage::GpuOnly);
+            }
+
+            for (TransientImage& image : wanted) {
+                const Allocation& allocation = m_memorySlots[image.slot].allocation;
+                if (vkBindImageMemory(device, image.image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+                    throw std::runtime_error("Failed to bind transient image memory!");
+                }
+
+                VkImageViewCreateInfo viewCreateInfo{};
+                viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+                viewCreateInfo.image = image.image;
+                viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+                viewCreateInfo.format = image.desc.format;
+                viewCreateInfo.subresourceRange.aspectMask = getAspect(image.desc.format);
+                viewCreateInfo.subresourceRange.baseMipLevel = 0;
+                viewCreateInfo.subresourceRange.levelCount = 1;
+                viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+                viewCreateInfo.subresourceRange.layerCount = 1;
+
+                if (vkCreateImageView(device, &viewCreateInfo, nullptr, &image.imageView) != VK_SUCCESS) {
+                    throw std::runtime_error("Failed to create transient image view!");
+                }
+            }
+
+            m_transientImages = std::move(wanted);
+            LOG_DEBUGF("Render graph placed {} transient images in {} memory slots ({} KiB)",
+                m_transientImages.size(), m_memorySlots.size(), getTransientMemorySize() >> 10);
+        }
+
+        for (size_t i = 0; i < used.size(); i++) {
+            m_resources[used[i]].image = m_transientImages[i].image;
+            m_resources[used[i]].imageView = m_transientImages[i].imageView;
+        }
+    }
+
+    void VulkanRenderGraph::destroyTransientImages(const bool immediately) {
+        if (m_transientImages.empty() && m_memorySlots.empty()) return;
+
+        auto destroy = [allocator = m_allocator, images = std::move(m_transientImages), slots = std::move(m_memorySlots)]() mutable {
+            for (const TransientImage& image : images) {
+                vkDestroyImageView(allocator->getDevice(), image.imageView, nullptr);
+                vkDestroyImage(allocator->getDevice(), image.image, nullptr);
+            }
+            for (MemorySlot& slot : slots) allocator->freeMemory(slot.allocation);
+        };
+        m_transientImages.clear();
+        m_memorySlots.clear();
+
+        //earlier frames may still be using them
+        if (immediately) {
+            destroy();
+        }else {
+            m_retire(std::move(destroy));
+        }
+    }
+
+    void VulkanRenderGraph::buildBarriers() {
+        std::vector<TrackedState> states(m_resources.size());
+        for (size_t i = 0; i < m_resources.size(); i++) {
+            const Resource& resource = m_resources[i];
+            if (resource.transient) {
+                //whatever used the memory last, an aliased image or the previous frame, has to be done with it
+                states[i] = {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_WRITE_BIT};
+            }else {
+                states[i] = {resource.initialState.layout, resource.initialState.stage, resource.initialState.access};
+            }
+        }
+
+        for (Pass& pass : m_passes) {
+            pass.imageBarriers.clear();
+            pass.memoryBarrier = {};
+            if (pass.culled) continue;
+
+            for (const Access& access : pass.accesses) {
+                const Resource& resource = m_resources[access.resource];
+                TrackedState& state = states[access.resource];
+                const ResourceState& to = access.state;
+
+                const bool layoutChange = resource.isImage && state.layout != to.layout;
+
+                if (layoutChange || access.writes) {
+                    //write after write or a transition, waits for the last write and every read since
+                    if (layoutChange || state.writeStage != VK_PIPELINE_STAGE_2_NONE || state.readStages != VK_PIPELINE_STAGE_2_NONE) {
+                        addBarrier(pass.imageBarriers, pass.memoryBarrier, resource, state, to);
+                    }
+
+                    state.layout = access.writes && access.layoutAfter != VK_IMAGE_LAYOUT_UNDEFINED ? access.layoutAfter : to.layout;
+                    state.writeStage = to.stage;
+                    state.writeAccess = access.writes ? to.access : VK_ACCESS_2_NONE;//a transition is made visible by its own barrier
+                    state.readStages = access.writes ? VK_PIPELINE_STAGE_2_NONE : to.stage;
+                    state.readAccess = access.writes ? VK_ACCESS_2_NONE : to.access;
+                    continue;
+                }
+
+                //read after write, skipped when an earlier read already made the write visible to this stage
+                const bool covered = (state.readStages & to.stage) == to.stage && (state.readAccess & to.access) == to.access;
+                if (!covered && (state.writeStage != VK_PIPELINE_STAGE_2_NONE || state.writeAccess != VK_ACCESS_2_NONE)) {
+                    TrackedState from = state;
+                    from.readStages = VK_PIPELINE_STAGE_2_NONE;
+                    addBarrier(pass.imageBarriers, pass.memoryBarrier, resource, from, to);
+                }
+                state.readStages |= to.stage;
+                state.readAccess |= to.access;
+            }
+        }
+
+        for (size_t i = 0; i < m_resources.size(); i++) {
+            const Resource& resource = m_resources[i];
+            if (!resource.exported) continue;
+
+            const TrackedState& state = states[i];
+            const ResourceState& to = resource.finalState;
+            const bool layoutChange = resource.isImage && to.layout != VK_IMAGE_LAYOUT_UNDEFINED && state.layout != to.layout;
+            const bool needsVisibility = to.access != VK_ACCESS_2_NONE && state.writeAccess != VK_ACCESS_2_NONE;
+
+            if (layoutChange || needsVisibility) {
+                ResourceState target = to;
+                if (!layoutChange) target.layout = state.layout;
+                addBarrier(m_finalImageBarriers, m_finalMemoryBarrier, resource, state, target);
+            }
+        }
+    }
+
+    void VulkanRenderGraph::addBarrier(std::vector<VkImageMemoryBarrier2>& imageBarriers, VkMemoryBarrier2& memoryBarrier,
+                                       const Resource& resource, const TrackedState& from, const ResourceState& to) {
+        const VkPipelineStageFlags2 srcStage = from.writeStage | from.readStages;
+
+        //without a layout change one global barrier for the whole pass is all it takes
+        if (!resource.isImage || from.layout == to.layout) {
+            memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+            memoryBarrier.srcStageMask |= srcStage;
+            memoryBarrier.srcAccessMask |= from.writeAccess;
+            memoryBarrier.dstStageMask |= to.stage;
+            memoryBarrier.dstAccessMask |= to.access;
+            return;
+        }
+
+        VkImageMemoryBarrier2 barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        barrier.srcStageMask = srcStage;
+        barrier.srcAccessMask = from.writeAccess;
+        barrier.dstStageMask = to.stage;
+        barrier.dstAccessMask = to.access;
+        barrier.oldLayout = from.layout;
+        barrier.newLayout = to.layout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = resource.image;
+        barrier.subresourceRange = {resource.aspect, 0, 1, 0, 1};
+        imageBarriers.push_back(barrier);
+    }
+
+    // ReSharper disable once CppParameterMayBeConst
+    void VulkanRenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const std::vector<VkImageMemoryBarrier2>& imageBarriers,
+                                           const VkMemoryBarrier2& memoryBarrier) const {
+        const bool hasMemoryBarrier = memoryBarrier.sType == VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+        if (imageBarriers.empty() && !hasMemoryBarrier) return;
+
+        if (m_pipelineBarrier2) {
+            VkDependencyInfo dependencyInfo{};
+            dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            dependencyInfo.memoryBarrierCount = hasMemoryBarrier ? 1 : 0;
+            dependencyInfo.pMemoryBarriers = &memoryBarrier;
+            dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+            dependencyInfo.pImageMemoryBarriers = imageBarriers.data();
+
+            m_pipelineBarrier2(commandBuffer, &dependencyInfo);
+            return;
+        }
+
+        //without synchronization2 all stages go into one call, the states only use bits that mean the same in both
+        VkPipelineStageFlags srcStages = 0, dstStages = 0;
+
+        VkMemoryBarrier legacyMemoryBarrier{};
+        legacyMemoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        if (hasMemoryBarrier) {
+            srcStages |= static_cast<VkPipelineStageFlags>(memoryBarrier.srcStageMask);
+            dstStages |= static_cast<VkPipelineStageFlags>(memoryBarrier.dstStageMask);
+            legacyMemoryBarrier.srcAccessMask = static_cast<VkAccessFlags>(memoryBarrier.srcAccessMask);
+            legacyMemoryBarrier.dstAccessMask = static_cast<VkAccessFlags>(memoryBarrier.dstAccessMask);
+        }
+
+        std::vector<VkImageMemoryBarrier> legacyImageBarriers;
+        legacyImageBarriers.reserve(imageBarriers.size());
+        for (const VkImageMemoryBarrier2& barrier : imageBarriers) {
+            srcStages |= static_cast<VkPipelineStageFlags>(barrier.srcStageMask);
+            dstStages |= static_cast<VkPipelineStageFlags>(barrier.dstStageMask);
+
+            VkImageMemoryBarrier legacyBarrier{};
+            legacyBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            legacyBarrier.srcAccessMask = static_cast<VkAccessFlags>(barrier.srcAccessMask);
+            legacyBarrier.dstAccessMask = static_cast<VkAccessFlags>(barrier.dstAccessMask);
+            legacyBarrier.oldLayout = barrier.oldLayout;
+            legacyBarrier.newLayout = barrier.newLayout;
+            legacyBarrier.srcQueueFamilyIndex = barrier.srcQueueFamilyIndex;
+            legacyBarrier.dstQueueFamilyIndex = barrier.dstQueueFamilyIndex;
+            legacyBarrier.image = barrier.image;
+            legacyBarrier.subresourceRange = barrier.subresourceRange;
+            legacyImageBarriers.push_back(legacyBarrier);
+        }
+
+        //no stage is spelled top and bottom of pipe there
+        if (srcStages == 0) srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        if (dstStages == 0) dstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0,
+            hasMemoryBarrier ? 1 : 0, &legacyMemoryBarrier, 0, nullptr,
+            static_cast<uint32_t>(legacyImageBarriers.size()), legacyImageBarriers.data());
+    }
+
+}
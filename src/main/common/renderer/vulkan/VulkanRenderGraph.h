@@ -0,0 +1,175 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "VulkanAllocator.h"
+#include "VulkanGpuProfiler.h"
+
+namespace Coreful::renderer::vulkan {
+
+    //how a pass uses a resource, the layout is ignored for buffers
+    struct ResourceState {
+        VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 access = VK_ACCESS_2_NONE;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    };
+
+    //only stages and accesses that exist without synchronization2 too, so the fallback can narrow them to 32 bits
+    inline constexpr ResourceState COLOR_ATTACHMENT_STATE{VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    inline constexpr ResourceState SHADER_READ_STATE{VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+        VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    inline constexpr ResourceState TRANSFER_SRC_STATE{VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+        VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL};
+    inline constexpr ResourceState TRANSFER_DST_STATE{VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+        VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL};
+    inline constexpr ResourceState HOST_READ_STATE{VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+    //the present semaphore waits for everything else
+    inline constexpr ResourceState PRESENT_STATE{VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR};
+
+    //an image that only lives while the graph executes, owned by the graph,
+    //depth and stencil formats get their aspects in views and barriers
+    struct TransientImageDesc {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkExtent2D extent{};
+        VkImageUsageFlags usage = 0;
+
+        bool operator==(const TransientImageDesc& other) const {
+            return format == other.format && extent.width == other.extent.width && extent.height == other.extent.height && usage == other.usage;
+        }
+    };
+
+    using RenderGraphResource = uint32_t;
+    using RenderGraphPass = uint32_t;
+
+    //passes are declared every frame in execution order together with the resources they read and write,
+    //compile() drops passes no exported resource depends on, works out the barriers between the rest
+    //and places transient images whose lifetimes don't overlap in the same memory
+    class VulkanRenderGraph {
+
+    public:
+
+        //retire has to keep its argument alive until every frame submitted so far has finished
+        void init(VulkanAllocator& allocator, PFN_vkCmdPipelineBarrier2 pipelineBarrier2, std::function<void(std::function<void()>)> retire);
+        void cleanup();
+
+        //forgets the last frame's passes and resources, transient images are kept for the next compile
+        void reset();
+
+        //state is what the resource is in when the graph starts
+        RenderGraphResource importImage(const char* name, VkImage image, VkImageView imageView, const ResourceState& state);
+        RenderGraphResource importBuffer(const char* name, VkBuffer buffer, const ResourceState& state);
+        RenderGraphResource createImage(const char* name, const TransientImageDesc& desc);
+
+        //the resource has to be left in state once the graph is done, passes it depends on are never culled
+        void exportResource(RenderGraphResource resource, const ResourceState& state);
+
+        //name has to outlive the graph, string literals are expected
+        RenderGraphPass addPass(const char* name, std::function<void(VkCommandBuffer)> execute);
+        void read(RenderGraphPass pass, RenderGraphResource resource, const ResourceState& state);
+        //layoutAfter is for passes that transition the image themselves, like a render pass with a final layout
+        void write(RenderGraphPass pass, RenderGraphResource resource, const ResourceState& state,
+            VkImageLayout layoutAfter = VK_IMAGE_LAYOUT_UNDEFINED);
+
+        void compile();
+        void execute(VkCommandBuffer commandBuffer, VulkanGpuProfiler& profiler) const;
+
+        //valid from compile() until the next reset()
+        [[nodiscard]] VkImage getImage(RenderGraphResource resource) const {return m_resources[resource].image;}
+        [[nodiscard]] VkImageView getImageView(RenderGraphResource resource) const {return m_resources[resource].imageView;}
+        [[nodiscard]] VkBuffer getBuffer(RenderGraphResource resource) const {return m_resources[resource].buffer;}
+        [[nodiscard]] bool isCulled(const RenderGraphPass pass) const {return m_passes[pass].culled;}
+
+        //memory backing transient images right now, aliased images share it
+        [[nodiscard]] VkDeviceSize getTransientMemorySize() const;
+
+    private:
+
+        struct Resource {
+            const char* name = nullptr;
+            bool isImage = true;
+            VkImage image = VK_NULL_HANDLE;
+            VkImageView imageView = VK_NULL_HANDLE;
+            VkBuffer buffer = VK_NULL_HANDLE;
+            VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;//imported images are color
+            ResourceState initialState;
+            bool exported = false;
+            ResourceState finalState;
+
+            //transient images
+            bool transient = false;
+            TransientImageDesc desc;
+            uint32_t firstPass = UINT32_MAX, lastPass = 0;
+        };
+
+        struct Access {
+            RenderGraphResource resource;
+            ResourceState state;
+            bool reads = false;
+            bool writes = false;
+            VkImageLayout layoutAfter = VK_IMAGE_LAYOUT_UNDEFINED;
+        };
+
+        struct Pass {
+            const char* name;
+            std::function<void(VkCommandBuffer)> execute;
+            std::vector<Access> accesses;
+            bool culled = false;
+            //recorded before the pass, images only get their own barrier when the layout changes
+            std::vector<VkImageMemoryBarrier2> imageBarriers;
+            VkMemoryBarrier2 memoryBarrier{};
+        };
+
+        //what a resource went through since the last barrier that covered it
+        struct TrackedState {
+            VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkPipelineStageFlags2 writeStage = VK_PIPELINE_STAGE_2_NONE;
+            VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+            VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE;//already waiting for the last write
+            VkAccessFlags2 readAccess = VK_ACCESS_2_NONE;//already seeing the last write
+        };
+
+        //persistent across frames, rebuilt only when the transient images or their lifetimes change
+        struct TransientImage {
+            TransientImageDesc desc;
+            uint32_t firstPass = 0, lastPass = 0;
+            uint32_t slot = 0;
+            VkImage image = VK_NULL_HANDLE;
+            VkImageView imageView = VK_NULL_HANDLE;
+        };
+
+        struct MemorySlot {
+            VkMemoryRequirements requirements{};
+            uint32_t lastPass = 0;
+            Allocation allocation;
+        };
+
+        VulkanAllocator* m_allocator = nullptr;
+        PFN_vkCmdPipelineBarrier2 m_pipelineBarrier2 = nullptr;//null without synchronization2
+        std::function<void(std::function<void()>)> m_retire;
+
+        std::vector<Resource> m_resources;
+        std::vector<Pass> m_passes;
+        std::vector<VkImageMemoryBarrier2> m_finalImageBarriers;
+        VkMemoryBarrier2 m_finalMemoryBarrier{};
+
+        std::vector<TransientImage> m_transientImages;
+        std::vector<MemorySlot> m_memorySlots;
+
+        static VkImageAspectFlags getAspect(VkFormat format);
+
+        void use(RenderGraphPass pass, RenderGraphResource resource, const ResourceState& state, bool reads, bool writes, VkImageLayout layoutAfter);
+        void cull();
+        void placeTransientImages();
+        void destroyTransientImages(bool immediately);
+        void buildBarriers();
+        static void addBarrier(std::vector<VkImageMemoryBarrier2>& imageBarriers, VkMemoryBarrier2& memoryBarrier,
+            const Resource& resource, const TrackedState& from, const ResourceState& to);
+        void recordBarriers(VkCommandBuffer commandBuffer, const std::vector<VkImageMemoryBarrier2>& imageBarriers,
+            const VkMemoryBarrier2& memoryBarrier) const;
+
+    };
+
+}
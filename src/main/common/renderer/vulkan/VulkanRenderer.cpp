@@ -1,11 +1,16 @@
 
 #include "VulkanRenderer.h"
 
+#include "core/JobSystem.h"
+
+#include <algorithm>
 #include <cstring>
 #include <set>
 #include <vector>
 
+#include "ShaderRegistry.h"
 #include "util/Logger.h"
+#include "util/Profiler.h"
 
 #ifdef NDEBUG
 constexpr bool ENABLE_VALIDATION_LAYERS = false;
@@ -15,14 +20,23 @@ constexpr bool ENABLE_VALIDATION_LAYERS = true;
 
 const std::vector VALIDATION_LAYERS = {"VK_LAYER_KHRONOS_validation"};
 
+constexpr VkClearColorValue CLEAR_COLOR = {{0.2f, 0.3f, 0.3f, 1.0f}};
+
 namespace Coreful::renderer::vulkan {
 
     void VulkanRenderer::init(PlatformWindow& window){
         m_window = &window;
+        m_windowWidth = window.getWidth().raw();
+        m_windowHeight = window.getHeight().raw();
         createInstance();
         createSurface(window);
         pickPhysicalDevice();
         createLogicalDevice();
+        createAllocator();
+        createRenderGraph();
+        createPipelineCache();
+        createUploader();
+        createTextureTable();
         createSyncObjects();
         initializeSwapchain(window);
         createRenderPass();
@@ -30,12 +44,35 @@ namespace Coreful::renderer::vulkan {
         createFramebuffers();
         createCommandPool();
         createCommandBuffers();
-
-        for (size_t i = 0; i < m_commandBuffers.size(); i++) recordCommandBuffers(m_commandBuffers[i], static_cast<uint32_t>(i));
+        createQuadBatch();
+        createGpuProfiler();
 
         log(Logger::LogType::Info, "Vulkan Initialized!");
     }
 
+    void VulkanRenderer::initHeadless(const uint32_t width, const uint32_t height) {
+        m_headless = true;
+        createInstance();
+        pickPhysicalDevice();
+        createLogicalDevice();
+        createAllocator();
+        createRenderGraph();
+        createPipelineCache();
+        createUploader();
+        createTextureTable();
+        createSyncObjects();
+        createOffscreenTargets(width, height);
+        createRenderPass();
+        createGraphicsPipeline();
+        createFramebuffers();
+        createCommandPool();
+        createCommandBuffers();
+        createQuadBatch();
+        createGpuProfiler();
+
+        log(Logger::LogType::Info, "Vulkan Initialized! (headless)");
+    }
+
     void VulkanRenderer::createInstance() {
         VkApplicationInfo appInfo = {};
         appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -43,7 +80,7 @@ namespace Coreful::renderer::vulkan {
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "Coreful Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_2;
+        appInfo.apiVersion = VK_API_VERSION_1_3;//the highest we use, 1.2 devices still work
 
         VkInstanceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -51,17 +88,29 @@ namespace Coreful::renderer::vulkan {
         createInfo.pNext = nullptr;
         createInfo.flags = 0;
 
-        const std::vector extensions = VulkanPlatform::requiredInstanceExtensions();
-
-
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
-        createInfo.ppEnabledExtensionNames = extensions.data();
+        //without a surface there is nothing platform specific to enable
+        std::vector extensions = m_headless ? std::vector<const char*>{} : VulkanPlatform::requiredInstanceExtensions();
 
         uint32_t extCount = 0;
         vkEnumerateInstanceExtensionProperties(nullptr, &extCount, nullptr);
         std::vector<VkExtensionProperties> available(extCount);
         vkEnumerateInstanceExtensionProperties(nullptr, &extCount, available.data());
 
+        //needed to ask the surface which present modes a swapchain can switch between
+        const auto isAvailable = [&available](const char* name) {
+            return std::ranges::any_of(available, [name](const VkExtensionProperties& extension) {
+                return strcmp(extension.extensionName, name) == 0;
+            });
+        };
+        if (!m_headless && isAvailable(VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME) && isAvailable(VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME)) {
+            extensions.push_back(VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME);
+            extensions.push_back(VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME);
+            m_hasSurfaceMaintenance1 = true;
+        }
+
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+        createInfo.ppEnabledExtensionNames = extensions.data();
+
         if (ENABLE_VALIDATION_LAYERS && !checkValidationLayerSupport()) {
             throw std::runtime_error("Validation layers requested, but not available!");
         }
@@ -96,13 +145,20 @@ namespace Coreful::renderer::vulkan {
             throw std::runtime_error("Failed to find GPUs with Vulkan support!");
         }
 
-        std::vector<VkPhysicalDevice> devices(deviceCount);
-        vkEnumeratePhysicalDevices(m_instance, &deviceCount, devices.data());
+        VulkanDeviceSelector selector;
+        const std::vector<DeviceCandidate> candidates = selector.rank(m_instance, !m_headless, m_preferredDevice);
 
-        for(const auto& device : devices) {
-            if (QueueFamilyIndices indices = findQueueFamilies(device, m_surface); indices.isComplete()) {
-                m_physicalDevice = device;
+        //best first, the queue families depend on the surface so they are checked here instead of cached
+        for (const DeviceCandidate& candidate : candidates) {
+            if (QueueFamilyIndices indices = findQueueFamilies(candidate.device, m_surface); indices.isComplete()) {
+                m_physicalDevice = candidate.device;
                 m_queueFamilyIndices = indices;
+                selector.save();
+
+                log(Logger::LogType::Info, "Using gpu ", candidate.capabilities.name);
+                if (candidate.capabilities.type == VK_PHYSICAL_DEVICE_TYPE_CPU) {
+                    log(Logger::LogType::Warn, "Rendering on a cpu rasterizer, expect it to be slow");
+                }
                 return;
             }
         }
@@ -114,9 +170,12 @@ namespace Coreful::renderer::vulkan {
         constexpr float queuePriority = 1.0f;
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+        const uint32_t transferFamily = m_queueFamilyIndices.transferFamily.value_or(m_queueFamilyIndices.graphicsFamily.value());
+
         const std::set uniqueQueues = {
             m_queueFamilyIndices.graphicsFamily.value(),
-            m_queueFamilyIndices.presentFamily.value()
+            m_queueFamilyIndices.presentFamily.value(),
+            transferFamily
         };
 
         for (const uint32_t family : uniqueQueues) {
@@ -138,18 +197,124 @@ namespace Coreful::renderer::vulkan {
         std::vector<VkExtensionProperties> availableExtensions(extensionCount);
         vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, availableExtensions.data());
 
-        bool maintenance1Supported = false;
-        for (const auto& extension : availableExtensions) {
-            if (strcmp(extension.extensionName, VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME) == 0) {
-                maintenance1Supported = true;
-                break;
-            }
+        const auto isAvailable = [&availableExtensions](const char* name) {
+            return std::ranges::any_of(availableExtensions, [name](const VkExtensionProperties& extension) {
+                return strcmp(extension.extensionName, name) == 0;
+            });
+        };
+
+        const bool incrementalPresentSupported = !m_headless && isAvailable(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+
+        //swapchain maintenance1 depends on its surface counterpart on the instance, and is an extension and a feature
+        VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT maintenance1Support{};
+        maintenance1Support.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT;
+        VkPhysicalDeviceFeatures2 supportedMaintenanceFeatures{};
+        supportedMaintenanceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supportedMaintenanceFeatures.pNext = &maintenance1Support;
+
+        bool maintenance1Supported = !m_headless && m_hasSurfaceMaintenance1 && isAvailable(VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME);
+        if (maintenance1Supported) {
+            vkGetPhysicalDeviceFeatures2(m_physicalDevice, &supportedMaintenanceFeatures);
+            maintenance1Supported = maintenance1Support.swapchainMaintenance1;
+        }
+
+        //present id and present wait are extensions and features, both have to be there
+        VkPhysicalDevicePresentWaitFeaturesKHR presentWaitSupport{};
+        presentWaitSupport.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+        VkPhysicalDevicePresentIdFeaturesKHR presentIdSupport{};
+        presentIdSupport.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+        presentIdSupport.pNext = &presentWaitSupport;
+        VkPhysicalDeviceFeatures2 supportedFeatures{};
+        supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supportedFeatures.pNext = &presentIdSupport;
+
+        bool presentWaitSupported = !m_headless
+            && isAvailable(VK_KHR_PRESENT_ID_EXTENSION_NAME) && isAvailable(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+        if (presentWaitSupported) {
+            vkGetPhysicalDeviceFeatures2(m_physicalDevice, &supportedFeatures);
+            presentWaitSupported = presentIdSupport.presentId && presentWaitSupport.presentWait;
+        }
+
+        //dynamic rendering and synchronization2 are core from 1.3 on and extensions before that
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(m_physicalDevice, &deviceProperties);
+        const bool vulkan13Core = deviceProperties.apiVersion >= VK_API_VERSION_1_3;
+
+        //render passes and framebuffers are the fallback
+
+        VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingSupport{};
+        dynamicRenderingSupport.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+        VkPhysicalDeviceFeatures2 supportedRenderingFeatures{};
+        supportedRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supportedRenderingFeatures.pNext = &dynamicRenderingSupport;
+
+        bool dynamicRenderingSupported = vulkan13Core || isAvailable(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        if (dynamicRenderingSupported) {
+            vkGetPhysicalDeviceFeatures2(m_physicalDevice, &supportedRenderingFeatures);
+            dynamicRenderingSupported = dynamicRenderingSupport.dynamicRendering;
         }
 
+        //render graph barriers fall back to vkCmdPipelineBarrier without it
+        VkPhysicalDeviceSynchronization2Features synchronization2Support{};
+        synchronization2Support.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+        VkPhysicalDeviceFeatures2 supportedSynchronizationFeatures{};
+        supportedSynchronizationFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supportedSynchronizationFeatures.pNext = &synchronization2Support;
+
+        bool synchronization2Supported = vulkan13Core || isAvailable(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+        if (synchronization2Supported) {
+            vkGetPhysicalDeviceFeatures2(m_physicalDevice, &supportedSynchronizationFeatures);
+            synchronization2Supported = synchronization2Support.synchronization2;
+        }
+
+        //core in 1.2, what frame synchronization and the texture table are built on,
+        //the descriptor indexing features are optional but VulkanDeviceSelector leaves out devices without them
+        VkPhysicalDeviceVulkan12Features vulkan12Features{};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        vulkan12Features.timelineSemaphore = VK_TRUE;
+        vulkan12Features.descriptorIndexing = VK_TRUE;
+        vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+        vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+        vulkan12Features.descriptorBindingVariableDescriptorCount = VK_TRUE;
+        void* featureChain = &vulkan12Features;
+
         VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT swapchainMaintenance1Features{};
         swapchainMaintenance1Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT;
-        swapchainMaintenance1Features.pNext = nullptr;
         swapchainMaintenance1Features.swapchainMaintenance1 = VK_TRUE;
+        if (maintenance1Supported) {
+            swapchainMaintenance1Features.pNext = featureChain;
+            featureChain = &swapchainMaintenance1Features;
+        }
+
+        VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures{};
+        dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+        dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+        if (dynamicRenderingSupported) {
+            dynamicRenderingFeatures.pNext = featureChain;
+            featureChain = &dynamicRenderingFeatures;
+        }
+
+        VkPhysicalDeviceSynchronization2Features synchronization2Features{};
+        synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+        synchronization2Features.synchronization2 = VK_TRUE;
+        if (synchronization2Supported) {
+            synchronization2Features.pNext = featureChain;
+            featureChain = &synchronization2Features;
+        }
+
+        VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+        presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+        presentIdFeatures.presentId = VK_TRUE;
+        VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+        presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+        presentWaitFeatures.presentWait = VK_TRUE;
+        if (presentWaitSupported) {
+            presentIdFeatures.pNext = featureChain;
+            presentWaitFeatures.pNext = &presentIdFeatures;
+            featureChain = &presentWaitFeatures;
+        }
 
 
         VkDeviceCreateInfo createInfo{};
@@ -157,10 +322,18 @@ namespace Coreful::renderer::vulkan {
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.pNext = maintenance1Supported ? &swapchainMaintenance1Features : nullptr;
+        createInfo.pNext = featureChain;
 
-        std::vector deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+        std::vector<const char*> deviceExtensions;
+        if (!m_headless) {deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);}
         if (maintenance1Supported) {deviceExtensions.push_back(VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME);}
+        if (incrementalPresentSupported) {deviceExtensions.push_back(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);}
+        if (dynamicRenderingSupported && !vulkan13Core) {deviceExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);}
+        if (synchronization2Supported && !vulkan13Core) {deviceExtensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);}
+        if (presentWaitSupported) {
+            deviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+            deviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+        }
 
         createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
         createInfo.ppEnabledExtensionNames = deviceExtensions.data();
@@ -170,57 +343,77 @@ namespace Coreful::renderer::vulkan {
             throw std::runtime_error("Failed to create logical device!");
         }
 
-        uint32_t enabledCount = 0;
-        vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &enabledCount, nullptr);
-        std::vector<VkExtensionProperties> enabledExtensions(enabledCount);
-        vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &enabledCount, enabledExtensions.data());
+        m_hasSwapchainMaintenance1 = maintenance1Supported;
+        m_hasIncrementalPresent = incrementalPresentSupported;
 
-        m_hasSwapchainMaintenance1 = false;
-        for (const auto& extension : enabledExtensions) {
-            if (strcmp(extension.extensionName, VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME) == 0) {
-                m_hasSwapchainMaintenance1 = true;
-                break;
-            }
+        //not exported by every loader, so always fetched from the device
+        if (presentWaitSupported) {
+            m_waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(m_device, "vkWaitForPresentKHR"));
+        }
+        if (dynamicRenderingSupported) {
+            m_cmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRendering>(
+                vkGetDeviceProcAddr(m_device, vulkan13Core ? "vkCmdBeginRendering" : "vkCmdBeginRenderingKHR"));
+            m_cmdEndRendering = reinterpret_cast<PFN_vkCmdEndRendering>(
+                vkGetDeviceProcAddr(m_device, vulkan13Core ? "vkCmdEndRendering" : "vkCmdEndRenderingKHR"));
+            m_dynamicRendering = m_cmdBeginRendering && m_cmdEndRendering;
         }
+        if (synchronization2Supported) {
+            m_cmdPipelineBarrier2 = reinterpret_cast<PFN_vkCmdPipelineBarrier2>(
+                vkGetDeviceProcAddr(m_device, vulkan13Core ? "vkCmdPipelineBarrier2" : "vkCmdPipelineBarrier2KHR"));
+        }
+        LOG_DEBUGF("Swapchain maintenance1: {}, present wait: {}, incremental present: {}, dynamic rendering: {}, synchronization2: {}",
+            m_hasSwapchainMaintenance1, m_waitForPresent != nullptr, m_hasIncrementalPresent, m_dynamicRendering, m_cmdPipelineBarrier2 != nullptr);
 
         vkGetDeviceQueue(m_device, m_queueFamilyIndices.graphicsFamily.value(), 0, &m_graphicsQueue);
         vkGetDeviceQueue(m_device, m_queueFamilyIndices.presentFamily.value(), 0, &m_presentQueue);
+        vkGetDeviceQueue(m_device, transferFamily, 0, &m_transferQueue);
+    }
+
+    void VulkanRenderer::createAllocator() {
+        m_allocator.init(m_physicalDevice, m_device);
+    }
+
+    void VulkanRenderer::createRenderGraph() {
+        //transient images it replaces may still be in use by frames in flight
+        m_renderGraph.init(m_allocator, m_cmdPipelineBarrier2, [this](std::function<void()> destroy) {retire(0, std::move(destroy));});
+    }
+
+    void VulkanRenderer::createTextureTable() {
+        //the white texture goes up with the first frame's uploads
+        m_textureTable.init(m_physicalDevice, m_device, m_allocator, m_uploader,
+            [this](std::function<void()> destroy) {retire(0, std::move(destroy));});
+    }
+
+    void VulkanRenderer::createPipelineCache() {
+        m_pipelineCache.init(m_physicalDevice, m_device);
     }
 
     void VulkanRenderer::createSyncObjects() {
 
         m_imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        m_renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        m_inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
 
         VkSemaphoreCreateInfo semaphoreInfo{};
         semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-        VkFenceCreateInfo fenceInfo{};
-        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[i]) != VK_SUCCESS ||
-                vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]) != VK_SUCCESS ||
-                vkCreateFence(m_device, &fenceInfo, nullptr, &m_inFlightFences[i]) != VK_SUCCESS) {
-                throw std::runtime_error("Failed to create synchronization objects for a frame!");
-                }
+        //acquire only signals binary semaphores
+        for (auto& semaphore : m_imageAvailableSemaphores) {
+            if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create image available semaphore!");
+            }
         }
 
-        // --- Presentation fences (maintenance1) ---
-        if (m_hasSwapchainMaintenance1) {
-            m_presentFences.resize(MAX_FRAMES_IN_FLIGHT);
+        //counts finished frames, frame n signals n
+        VkSemaphoreTypeCreateInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        timelineInfo.initialValue = 0;
 
-            VkFenceCreateInfo presentFenceInfo{};
-            presentFenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-            presentFenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        VkSemaphoreCreateInfo timelineSemaphoreInfo{};
+        timelineSemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        timelineSemaphoreInfo.pNext = &timelineInfo;
 
-            for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-                if (vkCreateFence(m_device, &presentFenceInfo, nullptr, &m_presentFences[i]) != VK_SUCCESS) {
-                    throw std::runtime_error("Failed to create presentation fence!");
-                }
-            }
+        if (vkCreateSemaphore(m_device, &timelineSemaphoreInfo, nullptr, &m_frameTimeline) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create frame timeline semaphore!");
         }
     }
 
@@ -239,12 +432,21 @@ namespace Coreful::renderer::vulkan {
             window.getWidth().raw(),
             window.getHeight().raw(),
             m_queueFamilyIndices.graphicsFamily.value(),
-            m_queueFamilyIndices.presentFamily.value()
+            m_queueFamilyIndices.presentFamily.value(),
+            toVkPresentMode(m_presentMode),
+            m_hasSwapchainMaintenance1
             );
+        m_activePresentMode = m_swapchain.getPresentMode();
 
-        m_imagesInFlight.clear();
-        m_imagesInFlight.resize(m_swapchain.getImageCount(), VK_NULL_HANDLE);
+        m_imageFrames.assign(m_swapchain.getImageCount(), 0);
+        resetImageDamage();
 
+        createPerImageSemaphores();
+
+        LOG_DEBUG("Swapchain Initialized!");
+    }
+
+    void VulkanRenderer::createPerImageSemaphores() {
         m_renderFinishedSemaphoresPerImage.resize(m_swapchain.getImageCount());
         VkSemaphoreCreateInfo semaphoreInfo{};
         semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -254,20 +456,33 @@ namespace Coreful::renderer::vulkan {
                 throw std::runtime_error("Failed to create per-image render finished semaphore!");
             }
         }
+    }
 
-        log(Logger::LogType::Debug, "Swapchain Initialized!");
+    void VulkanRenderer::createOffscreenTargets(const uint32_t width, const uint32_t height) {
+        log(Logger::LogType::Info, "Creating Offscreen Targets...");
+
+        //one target per frame in flight, so a frame's timeline value also guards its target and readback buffer
+        m_offscreenTargets.init(
+            m_allocator,
+            width,
+            height,
+            VK_FORMAT_R8G8B8A8_UNORM,
+            MAX_FRAMES_IN_FLIGHT
+            );
     }
 
     void VulkanRenderer::createRenderPass() {
+        if (m_dynamicRendering) return;//rendering begins straight on the image views
+
         VkAttachmentDescription colorAttachment{};
-        colorAttachment.format = m_swapchain.getImageFormat();
+        colorAttachment.format = getColorFormat();
         colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;//TODO: add MSAA
         colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;//clear at the start
         colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;//store result for presentation
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; //ready for presentation
+        colorAttachment.finalLayout = m_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; //ready for readback or presentation
 
         VkAttachmentReference colorAttachmentRef{};
         colorAttachmentRef.attachment = 0;//index for attachment
@@ -292,14 +507,32 @@ namespace Coreful::renderer::vulkan {
         renderPassInfo.pAttachments = &colorAttachment;
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1;
+        renderPassInfo.dependencyCount = 1;//what comes after is up to the render graph
         renderPassInfo.pDependencies = &dependency;
 
         if (vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create render pass!");
         }
 
-        log(Logger::LogType::Debug, "Render Pass Created!");
+        //same pass keeping the image's previous contents, for frames that only redraw their damage
+        if (!m_headless) {
+            VkAttachmentDescription loadAttachment = colorAttachment;
+            loadAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+            loadAttachment.initialLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;//only used on images that were presented before
+
+            VkSubpassDependency loadDependency = dependency;
+            loadDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+            renderPassInfo.pAttachments = &loadAttachment;
+            renderPassInfo.dependencyCount = 1;
+            renderPassInfo.pDependencies = &loadDependency;
+
+            if (vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_loadRenderPass) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create partial redraw render pass!");
+            }
+        }
+
+        LOG_DEBUG("Render Pass Created!");
 
     }
 
@@ -309,19 +542,21 @@ namespace Coreful::renderer::vulkan {
     }
 
     void VulkanRenderer::createFramebuffers() {
+        if (m_dynamicRendering) return;
 
-        m_framebuffers.resize(m_swapchain.getImageViews().size());
+        const std::vector<VkImageView>& imageViews = m_headless ? m_offscreenTargets.getImageViews() : m_swapchain.getImageViews();
+        m_framebuffers.resize(imageViews.size());
 
-        for (size_t i = 0; i < m_swapchain.getImageViews().size(); i++) {
-            const VkImageView attachments[] = {m_swapchain.getImageViews()[i]};
+        for (size_t i = 0; i < imageViews.size(); i++) {
+            const VkImageView attachments[] = {imageViews[i]};
 
             VkFramebufferCreateInfo framebufferInfo{};
             framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
             framebufferInfo.renderPass = m_renderPass;
             framebufferInfo.attachmentCount = 1;
             framebufferInfo.pAttachments = attachments;
-            framebufferInfo.width = m_swapchain.getExtent().width;
-            framebufferInfo.height = m_swapchain.getExtent().height;
+            framebufferInfo.width = getRenderExtent().width;
+            framebufferInfo.height = getRenderExtent().height;
             framebufferInfo.layers = 1;
 
             if (vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &m_framebuffers[i]) != VK_SUCCESS) {
@@ -329,7 +564,7 @@ namespace Coreful::renderer::vulkan {
             }
         }
 
-        log(Logger::LogType::Debug, "Framebuffers Created!");
+        LOG_DEBUG("Framebuffers Created!");
 
     }
 
@@ -337,84 +572,278 @@ namespace Coreful::renderer::vulkan {
         VkCommandPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolInfo.queueFamilyIndex = m_queueFamilyIndices.graphicsFamily.value();
-        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;//re-recorded every frame
+
+        m_commandPools.resize(MAX_FRAMES_IN_FLIGHT);
 
-        if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to create command pool!");
+        for (auto& commandPool : m_commandPools) {
+            if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create command pool!");
+            }
         }
 
-        log(Logger::LogType::Debug, "Command Pool Created!");
+        //one chunk per thread that can record, a single chunk gains nothing over recording inline
+        uint32_t chunkCount = m_jobSystem ? std::min(MAX_RECORDING_CHUNKS, m_jobSystem->getWorkerCount() + 1) : 0;
+        if (chunkCount < 2) chunkCount = 0;
+        m_secondaryCommandBuffers.init(m_device, m_queueFamilyIndices.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT, chunkCount);
+
+        LOG_DEBUG("Command Pools Created!");
     }
 
     void VulkanRenderer::createCommandBuffers() {
-        m_commandBuffers.resize(m_framebuffers.size());
-
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = m_commandPool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = static_cast<uint32_t>(m_commandBuffers.size());
+        m_commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 
-        if (vkAllocateCommandBuffers(m_device, &allocInfo, m_commandBuffers.data()) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to allocate command buffers!");
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = m_commandPools[i];
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+
+            if (vkAllocateCommandBuffers(m_device, &allocInfo, &m_commandBuffers[i]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to allocate command buffers!");
+            }
         }
 
-        log(Logger::LogType::Debug, "Command Buffers Created!");
+        LOG_DEBUG("Command Buffers Created!");
+    }
+
+    void VulkanRenderer::createQuadBatch() {
+        m_quadBatch.init(m_allocator, MAX_FRAMES_IN_FLIGHT);
+    }
+
+    void VulkanRenderer::createGpuProfiler() {
+        m_gpuProfiler.init(m_physicalDevice, m_device, m_queueFamilyIndices.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT);
     }
 
-    void VulkanRenderer::recordCommandBuffers(VkCommandBuffer commandBuffer, uint32_t imageIndex) const {
+    void VulkanRenderer::createUploader() {
+        m_uploader.init(m_allocator, m_queueFamilyIndices, m_transferQueue, MAX_FRAMES_IN_FLIGHT);
+    }
+
+    void VulkanRenderer::recordCommandBuffers(VkCommandBuffer commandBuffer, uint32_t imageIndex, const DamageRegion& damage) {
+
+        const VkExtent2D extent = getRenderExtent();
+        const auto frameIndex = static_cast<uint32_t>(m_currentFrame);
+
+        //a partial frame loads the image, clears and redraws only the damaged bounds
+        const bool partial = !damage.isFull();
+        const DamageRect bounds = damage.getBounds(extent.width, extent.height);
+        const VkRect2D area{{bounds.x, bounds.y}, {bounds.width, bounds.height}};
+
+        //large frames are split into instance ranges, each recorded by a worker while the primary buffer is built
+        const uint32_t quadCount = m_quadBatch.getCount();
+        const uint32_t chunkCount = std::min(m_secondaryCommandBuffers.getChunkCount(), quadCount / MIN_QUADS_PER_CHUNK);
+        const bool recordInParallel = chunkCount > 1;
 
-        vkResetCommandBuffer(commandBuffer, 0);
+        //the setup below can throw before the render pass waits, and the jobs still count down and record until they are done,
+        //a chunk that failed was either rethrown by the pass already or loses to the exception leaving this function
+        struct RecordingJobs {
+            JobSystem* jobSystem;
+            JobCounter counter;
+
+            ~RecordingJobs() {
+                if (!jobSystem) return;
+                try {
+                    jobSystem->wait(counter);
+                } catch (...) {}
+            }
+        } recordingJobs{m_jobSystem, {}};
+        JobCounter& chunksRecorded = recordingJobs.counter;
+
+        if (recordInParallel) {
+            for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+                m_jobSystem->run(chunksRecorded, [this, chunk, chunkCount, quadCount, extent, area, partial, frameIndex, imageIndex] {
+                    const uint32_t first = quadCount * chunk / chunkCount;
+                    const uint32_t last = quadCount * (chunk + 1) / chunkCount;
+
+                    VkCommandBuffer secondary = m_dynamicRendering
+                        ? m_secondaryCommandBuffers.beginRendering(frameIndex, chunk, getColorFormat())
+                        : m_secondaryCommandBuffers.begin(frameIndex, chunk, m_renderPass, m_framebuffers[imageIndex]);
+                    //the primary can't, its subpass only executes secondaries, dynamic rendering clears the area on load
+                    if (partial && chunk == 0 && !m_dynamicRendering) recordClear(secondary, area);
+                    recordDrawState(secondary, extent, area);//nothing is inherited from the primary
+                    m_quadBatch.record(secondary, m_pipelineLayout, extent, first, last - first);
+
+                    if (vkEndCommandBuffer(secondary) != VK_SUCCESS) {
+                        throw std::runtime_error("Failed to record secondary command buffer!");
+                    }
+                });
+            }
+        }
 
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
         vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
-        VkRenderPassBeginInfo renderPassInfo{};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = m_renderPass;
-        renderPassInfo.framebuffer = m_framebuffers[imageIndex];
-        renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = m_swapchain.getExtent();
+        m_gpuProfiler.reset(commandBuffer, static_cast<uint32_t>(m_currentFrame));
+        const uint32_t frameScope = m_gpuProfiler.beginScope(commandBuffer, "frame");
+
+        //take ownership of whatever the transfer queue uploaded for this frame
+        {
+            GpuScope uploadScope(m_gpuProfiler, commandBuffer, "upload acquire");
+            m_uploader.recordAcquireBarriers(commandBuffer, static_cast<uint32_t>(m_currentFrame));
+        }
+
+        //the frame as passes, the graph puts the barriers between them
+        m_renderGraph.reset();
+
+        //dynamic rendering transitions the image itself once the acquire semaphore is waited on,
+        //the render passes' external dependency does that for the fallback and offscreen targets were waited for on the host
+        const ResourceState initialState{
+            m_dynamicRendering && !m_headless ? VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT : VK_PIPELINE_STAGE_2_NONE,
+            VK_ACCESS_2_NONE,
+            partial ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_UNDEFINED};
+        const RenderGraphResource color = m_renderGraph.importImage("color", getColorImage(imageIndex),
+            (m_headless ? m_offscreenTargets.getImageViews() : m_swapchain.getImageViews())[imageIndex], initialState);
+
+        const RenderGraphPass renderPass = m_renderGraph.addPass("render pass", [&](VkCommandBuffer passCommandBuffer) {
+            if (recordInParallel) {
+                //a subpass with secondary contents only takes vkCmdExecuteCommands, so no "quad batch" timestamp here
+                beginRendering(passCommandBuffer, imageIndex, area, partial, true);
+
+                {
+                    //rethrows a chunk that failed to record, its secondary isn't executable
+                    PROFILE_SCOPE("wait recording jobs");
+                    m_jobSystem->wait(chunksRecorded);
+                }
+                vkCmdExecuteCommands(passCommandBuffer, chunkCount, m_secondaryCommandBuffers.getCommandBuffers(frameIndex).data());
+            } else {
+                beginRendering(passCommandBuffer, imageIndex, area, partial, false);
+                if (partial && !m_dynamicRendering) recordClear(passCommandBuffer, area);
+                recordDrawState(passCommandBuffer, extent, area);
+
+                GpuScope batchScope(m_gpuProfiler, passCommandBuffer, "quad batch");
+                m_quadBatch.record(passCommandBuffer, m_pipelineLayout, extent);
+            }
+
+            endRendering(passCommandBuffer);
+        });
+
+        //the render pass moves the image between its initial and final layout on its own
+        ResourceState colorState = COLOR_ATTACHMENT_STATE;
+        if (!m_dynamicRendering) colorState.layout = initialState.layout;
+        const VkImageLayout layoutAfter = m_dynamicRendering ? VK_IMAGE_LAYOUT_UNDEFINED
+            : m_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        m_renderGraph.write(renderPass, color, colorState, layoutAfter);
+        if (partial) m_renderGraph.read(renderPass, color, colorState);//what is outside the damage is kept
+
+        if (m_headless) {
+            const OffscreenTarget& target = m_offscreenTargets.getTarget(imageIndex);
+            const RenderGraphResource readback = m_renderGraph.importBuffer("readback buffer", target.readbackBuffer, {});
+
+            const RenderGraphPass readbackPass = m_renderGraph.addPass("readback", [&extent, image = target.image, buffer = target.readbackBuffer](VkCommandBuffer passCommandBuffer) {
+                VkBufferImageCopy region{};
+                region.bufferOffset = 0;
+                region.bufferRowLength = 0;//tightly packed
+                region.bufferImageHeight = 0;
+                region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                region.imageSubresource.mipLevel = 0;
+                region.imageSubresource.baseArrayLayer = 0;
+                region.imageSubresource.layerCount = 1;
+                region.imageOffset = {0, 0, 0};
+                region.imageExtent = {extent.width, extent.height, 1};
+
+                vkCmdCopyImageToBuffer(passCommandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+            });
+            m_renderGraph.read(readbackPass, color, TRANSFER_SRC_STATE);
+            m_renderGraph.write(readbackPass, readback, TRANSFER_DST_STATE);
+
+            m_renderGraph.exportResource(readback, HOST_READ_STATE);
+        }else {
+            m_renderGraph.exportResource(color, PRESENT_STATE);
+        }
+
+        m_renderGraph.compile();
+        m_renderGraph.execute(commandBuffer, m_gpuProfiler);
+
+        m_gpuProfiler.endScope(commandBuffer, frameScope);
 
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to record command buffer!");
+        }
+
+    }
+
+    void VulkanRenderer::beginRendering(VkCommandBuffer commandBuffer, const uint32_t imageIndex, const VkRect2D area, const bool partial,
+                                        const bool secondaryContents) const {
         VkClearValue clearColor{};
-        clearColor.color = {0.2f, 0.3f, 0.3f, 1.0f};
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues = &clearColor;
+        clearColor.color = CLEAR_COLOR;
+
+        if (!m_dynamicRendering) {
+            VkRenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = partial ? m_loadRenderPass : m_renderPass;
+            renderPassInfo.framebuffer = m_framebuffers[imageIndex];
+            renderPassInfo.renderArea = area;
+            renderPassInfo.clearValueCount = 1;
+            renderPassInfo.pClearValues = &clearColor;
+
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, secondaryContents ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+            return;
+        }
 
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        //the clear only touches the render area, so a partial frame needs no separate clear
+        VkRenderingAttachmentInfo colorAttachment{};
+        colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        colorAttachment.imageView = (m_headless ? m_offscreenTargets.getImageViews() : m_swapchain.getImageViews())[imageIndex];
+        colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.clearValue = clearColor;
+
+        VkRenderingInfo renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+        renderingInfo.flags = secondaryContents ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
+        renderingInfo.renderArea = area;
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachments = &colorAttachment;
+
+        m_cmdBeginRendering(commandBuffer, &renderingInfo);
+    }
+
+    void VulkanRenderer::endRendering(VkCommandBuffer commandBuffer) const {
+        if (m_dynamicRendering) m_cmdEndRendering(commandBuffer);
+        else vkCmdEndRenderPass(commandBuffer);
+    }
 
+    void VulkanRenderer::recordClear(VkCommandBuffer commandBuffer, const VkRect2D area) {
+        VkClearAttachment clearAttachment{};
+        clearAttachment.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        clearAttachment.colorAttachment = 0;
+        clearAttachment.clearValue.color = CLEAR_COLOR;
 
+        VkClearRect clearRect{};
+        clearRect.rect = area;
+        clearRect.baseArrayLayer = 0;
+        clearRect.layerCount = 1;
+
+        vkCmdClearAttachments(commandBuffer, 1, &clearAttachment, 1, &clearRect);
+    }
+
+    void VulkanRenderer::recordDrawState(VkCommandBuffer commandBuffer, const VkExtent2D extent, const VkRect2D scissor) const {
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+        m_textureTable.bind(commandBuffer, m_pipelineLayout);
 
         VkViewport viewport{};
         viewport.x = 0.0f;
-        viewport.y = static_cast<float>(m_swapchain.getExtent().height);
-        viewport.width = static_cast<float>(m_swapchain.getExtent().width);
-        viewport.height = -static_cast<float>(m_swapchain.getExtent().height);
+        viewport.y = static_cast<float>(extent.height);
+        viewport.width = static_cast<float>(extent.width);
+        viewport.height = -static_cast<float>(extent.height);
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
         vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
-        const VkRect2D scissor{{0, 0}, m_swapchain.getExtent()};
         vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
-        vkCmdDraw(commandBuffer, 3, 1, 0, 0); //draws a single triangle
-
-        vkCmdEndRenderPass(commandBuffer);
-
-        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to record command buffer!");
-        }
-
     }
 
-    VkShaderModule VulkanRenderer::createShaderModule(const std::vector<char> &code) const {
+    VkShaderModule VulkanRenderer::createShaderModule(const std::span<const uint32_t> code) const {
         VkShaderModuleCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+        createInfo.codeSize = code.size_bytes();
+        createInfo.pCode = code.data();//embedded as uint32_t, already aligned
 
         VkShaderModule shaderModule;
         if (vkCreateShaderModule(m_device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
@@ -426,8 +855,8 @@ namespace Coreful::renderer::vulkan {
 
     void VulkanRenderer::createGraphicsPipeline() {
 
-        auto vertShaderCode = readFile("shaders/vert.spv");
-        auto fragShaderCode = readFile("shaders/frag.spv");
+        const std::span<const uint32_t> vertShaderCode = ShaderRegistry::get("vert");
+        const std::span<const uint32_t> fragShaderCode = ShaderRegistry::get("frag");
 
         VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
         VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
@@ -446,10 +875,15 @@ namespace Coreful::renderer::vulkan {
 
         VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
+        const VkVertexInputBindingDescription bindingDescription = VulkanQuadBatch::getBindingDescription();
+        const std::vector<VkVertexInputAttributeDescription> attributeDescriptions = VulkanQuadBatch::getAttributeDescriptions();
+
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = 0; // Optional
-        vertexInputInfo.vertexAttributeDescriptionCount = 0; // Optional
+        vertexInputInfo.vertexBindingDescriptionCount = 1;
+        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
         VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
         inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -459,12 +893,12 @@ namespace Coreful::renderer::vulkan {
         VkViewport viewport{};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
-        viewport.width = static_cast<float>(m_swapchain.getExtent().width);
-        viewport.height = static_cast<float>(m_swapchain.getExtent().height);
+        viewport.width = static_cast<float>(getRenderExtent().width);
+        viewport.height = static_cast<float>(getRenderExtent().height);
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
 
-        VkRect2D scissor{{0, 0}, m_swapchain.getExtent()};
+        VkRect2D scissor{{0, 0}, getRenderExtent()};
 
         VkPipelineViewportStateCreateInfo viewportState{};
         viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
@@ -479,7 +913,7 @@ namespace Coreful::renderer::vulkan {
         rasterizer.rasterizerDiscardEnable = VK_FALSE;
         rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
         rasterizer.lineWidth = 1.0f;
-        rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+        rasterizer.cullMode = VK_CULL_MODE_NONE;//2d quads, winding doesn't matter
         rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
         rasterizer.depthBiasEnable = VK_FALSE;
 
@@ -490,7 +924,13 @@ namespace Coreful::renderer::vulkan {
 
         VkPipelineColorBlendAttachmentState colorBlendAttachment{};
         colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-        colorBlendAttachment.blendEnable = VK_FALSE;
+        colorBlendAttachment.blendEnable = VK_TRUE;//standard alpha blending for ui
+        colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+        colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 
         VkPipelineColorBlendStateCreateInfo colorBlending{};
         colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
@@ -507,10 +947,18 @@ namespace Coreful::renderer::vulkan {
 
         //Pipeline Layout
 
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = 2 * sizeof(float);//screen size in pixels
+
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 0; // Optional
-        pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
+        const VkDescriptorSetLayout setLayout = m_textureTable.getSetLayout();
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &setLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
         if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create pipeline layout!");
@@ -531,7 +979,15 @@ namespace Coreful::renderer::vulkan {
         pipelineInfo.renderPass = m_renderPass;
         pipelineInfo.subpass = 0;
 
-        if (vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline) != VK_SUCCESS) {
+        //without a render pass the pipeline only needs to know the attachment formats
+        const VkFormat colorFormat = getColorFormat();
+        VkPipelineRenderingCreateInfo renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachmentFormats = &colorFormat;
+        if (m_dynamicRendering) pipelineInfo.pNext = &renderingInfo;
+
+        if (vkCreateGraphicsPipelines(m_device, m_pipelineCache.get(), 1, &pipelineInfo, nullptr, &m_graphicsPipeline) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create graphics pipeline!");
         }
 
@@ -543,17 +999,65 @@ namespace Coreful::renderer::vulkan {
 
 
 
+    void VulkanRenderer::beginFrame() {
+
+        //Wait for the frame last submitted from this slot, after that its instance buffer can be refilled
+        {
+            PROFILE_SCOPE("wait frame timeline");
+            waitForFrame(m_frameNumbers[m_currentFrame]);
+        }
+
+        //may be further along than the frame just waited for
+        vkGetSemaphoreCounterValue(m_device, m_frameTimeline, &m_completedFrame);
+        m_deletionQueue.flush(m_completedFrame);
+        if (m_hasSwapchainMaintenance1) releasePresentFences();
+
+        if (!m_headless && m_lowLatency.load(std::memory_order_relaxed)) waitForQueuedFrames();
+
+        m_quadBatch.begin(static_cast<uint32_t>(m_currentFrame));
+        m_uploader.beginFrame(static_cast<uint32_t>(m_currentFrame));
+        m_gpuProfiler.collect(m_device, static_cast<uint32_t>(m_currentFrame));
+        m_frameBegun = true;
+    }
+
+    void VulkanRenderer::submitQuad(const QuadInstance& quad) {
+        if (!m_frameBegun) beginFrame();
+        m_quadBatch.push(quad);
+    }
+
     void VulkanRenderer::render() {
+        PROFILE_SCOPE("render");
 
-        //Wait for this frame's in-flight fence
-        vkWaitForFences(m_device,1,&m_inFlightFences[m_currentFrame],VK_TRUE,UINT64_MAX);
-        vkResetFences(m_device,1,&m_inFlightFences[m_currentFrame]);
+        if (!m_frameBegun) beginFrame();
+        m_frameBegun = false;
+
+        if (m_headless) {
+            renderOffscreen();
+            return;
+        }
+
+        //rebuilt up front instead of waiting for acquire or present to report the old one out of date
+        if (const PresentMode requested = m_requestedPresentMode.load(std::memory_order_relaxed); requested != m_presentMode) {
+            applyPresentMode(requested);
+        }
+        if (m_resizeRequested && !recreateSwapchain()) return;//minimized, skip the frame
+
+        //what is on screen is still current
+        const bool damageTracking = m_damageTracking.load(std::memory_order_relaxed);
+        if (damageTracking && m_pendingDamage.getBounds(m_swapchain.getExtent().width, m_swapchain.getExtent().height).isEmpty()) {
+            m_pendingDamage.clear();
+            return;
+        }
 
         //Acquire next image
         uint32_t imageIndex;
-        const VkResult acquireResult = vkAcquireNextImageKHR(
-            m_device,m_swapchain.get(),UINT64_MAX,
-            m_imageAvailableSemaphores[m_currentFrame],VK_NULL_HANDLE, &imageIndex);
+        VkResult acquireResult;
+        {
+            PROFILE_SCOPE("acquire");
+            acquireResult = vkAcquireNextImageKHR(
+                m_device,m_swapchain.get(),UINT64_MAX,
+                m_imageAvailableSemaphores[m_currentFrame],VK_NULL_HANDLE, &imageIndex);
+        }
 
         if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR) { recreateSwapchain(); return; }
         if (acquireResult != VK_SUCCESS && acquireResult != VK_SUBOPTIMAL_KHR) {
@@ -561,11 +1065,34 @@ namespace Coreful::renderer::vulkan {
         }
 
 
-        //Wait for the fence tied to this image, if it exists
-        if (m_imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
-            vkWaitForFences(m_device, 1, &m_imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+        //the image can come back before the other frame slot that last drew into it has finished
+        if (m_imageFrames[imageIndex] > m_completedFrame) {
+            PROFILE_SCOPE("wait image frame");
+            waitForFrame(m_imageFrames[imageIndex]);
+        }
+        const uint64_t frameNumber = m_submittedFrame + 1;
+        m_imageFrames[imageIndex] = frameNumber;
+
+        //every image misses whatever changed since it was last drawn, not just this frame's damage
+        DamageRegion damage;
+        if (damageTracking) {
+            for (DamageRegion& imageDamage : m_imageDamage) imageDamage.merge(m_pendingDamage);
+            damage = m_imageDamage[imageIndex];
+            m_imageDamage[imageIndex].clear();
+        } else {
+            damage.markFull();
+        }
+
+        //the frame has finished, so everything allocated from this frame's pool is free to reset
+        {
+            PROFILE_SCOPE("record");
+            m_uploader.flush();
+            m_uploader.takePending(static_cast<uint32_t>(m_currentFrame));
+
+            vkResetCommandPool(m_device, m_commandPools[m_currentFrame], 0);
+            m_secondaryCommandBuffers.reset(m_device, static_cast<uint32_t>(m_currentFrame));
+            recordCommandBuffers(m_commandBuffers[m_currentFrame], imageIndex, damage);
         }
-        m_imagesInFlight[imageIndex] = m_inFlightFences[m_currentFrame];
 
         //Submit draw commands
 
@@ -573,53 +1100,118 @@ namespace Coreful::renderer::vulkan {
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        const VkSemaphore waitSemaphores[] = {m_imageAvailableSemaphores[m_currentFrame]};
-        constexpr VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
-
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &m_commandBuffers[imageIndex];
-
-        //--- Signal semaphores ---
-        VkSemaphore signalSemaphore;
-        if (m_hasSwapchainMaintenance1) {
-            signalSemaphore = m_renderFinishedSemaphores[m_currentFrame];
-        }else {
-            signalSemaphore = m_renderFinishedSemaphoresPerImage[imageIndex];
+        std::vector<VkSemaphore> waitSemaphores = {m_imageAvailableSemaphores[m_currentFrame]};
+        std::vector<VkPipelineStageFlags> waitStages = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+        for (const auto semaphore : m_uploader.getWaitSemaphores(static_cast<uint32_t>(m_currentFrame))) {
+            waitSemaphores.push_back(semaphore);
+            waitStages.push_back(VulkanUploader::WAIT_STAGE);
         }
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        submitInfo.pWaitSemaphores = waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
 
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = &signalSemaphore;
-
-        if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_inFlightFences[m_currentFrame]) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to submit draw command buffer!");
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &m_commandBuffers[m_currentFrame];
+
+        //per image, it is only signaled again once the image was re-acquired, so its last present is done with it
+        const VkSemaphore renderFinished = m_renderFinishedSemaphoresPerImage[imageIndex];
+        const VkSemaphore signalSemaphores[] = {renderFinished, m_frameTimeline};
+        const uint64_t signalValues[] = {0, frameNumber};//binary semaphores ignore theirs
+
+        VkTimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+        timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineSubmitInfo.signalSemaphoreValueCount = 2;
+        timelineSubmitInfo.pSignalSemaphoreValues = signalValues;
+
+        submitInfo.pNext = &timelineSubmitInfo;
+        submitInfo.signalSemaphoreCount = 2;
+        submitInfo.pSignalSemaphores = signalSemaphores;
+
+        {
+            PROFILE_SCOPE("submit");
+            if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to submit draw command buffer!");
+            }
         }
+        m_submittedFrame = frameNumber;
+        m_frameNumbers[m_currentFrame] = frameNumber;
 
         // Present
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = &signalSemaphore;
+        presentInfo.pWaitSemaphores = &renderFinished;
         const VkSwapchainKHR swapChains[] = {m_swapchain.get()};
         presentInfo.swapchainCount = 1;
         presentInfo.pSwapchains = swapChains;
         presentInfo.pImageIndices = &imageIndex;
 
 
-        //Only include a present fence if maintenance1 feature is enabled
+        //everything chained here has to live until vkQueuePresentKHR
+        const void* presentChain = nullptr;
+
+        //Only include a present mode if maintenance1 feature is enabled
+        VkSwapchainPresentModeInfoEXT swapchainPresentModeInfo{};
+        if (m_hasSwapchainMaintenance1) {
+            //switching between compatible modes needs no new swapchain
+            swapchainPresentModeInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_PRESENT_MODE_INFO_EXT;
+            swapchainPresentModeInfo.swapchainCount = 1;
+            swapchainPresentModeInfo.pPresentModes = &m_activePresentMode;
+            swapchainPresentModeInfo.pNext = presentChain;
+            presentChain = &swapchainPresentModeInfo;
+        }
+
+        //what retiring the swapchain waits for instead of guessing how many frames its presents take
+        VkSwapchainPresentFenceInfoEXT presentFenceInfo{};
+        const VkFence presentFence = m_hasSwapchainMaintenance1 ? acquirePresentFence() : VK_NULL_HANDLE;
         if (m_hasSwapchainMaintenance1) {
-            VkSwapchainPresentFenceInfoKHR swapchainPresentFenceInfo{};
-            vkWaitForFences(m_device, 1, &m_presentFences[m_currentFrame], VK_TRUE, UINT64_MAX);
-            vkResetFences(m_device, 1, &m_presentFences[m_currentFrame]);
-            swapchainPresentFenceInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_PRESENT_FENCE_INFO_KHR;
-            swapchainPresentFenceInfo.swapchainCount = 1;
-            swapchainPresentFenceInfo.pFences = &m_presentFences[m_currentFrame];
-            presentInfo.pNext = &swapchainPresentFenceInfo;
+            presentFenceInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_PRESENT_FENCE_INFO_EXT;
+            presentFenceInfo.swapchainCount = 1;
+            presentFenceInfo.pFences = &presentFence;
+            presentFenceInfo.pNext = presentChain;
+            presentChain = &presentFenceInfo;
         }
 
-        if (const VkResult presentResult = vkQueuePresentKHR(m_presentQueue, &presentInfo); presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR) {
+        //numbered presents are what present wait waits on
+        VkPresentIdKHR presentIdInfo{};
+        const uint64_t presentId = m_presentId + 1;
+        if (m_waitForPresent) {
+            presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+            presentIdInfo.swapchainCount = 1;
+            presentIdInfo.pPresentIds = &presentId;
+            presentIdInfo.pNext = presentChain;
+            presentChain = &presentIdInfo;
+        }
+        //tells the compositor what changed since the previous present, so it can skip the rest too
+        VkPresentRegionKHR presentRegion{};
+        VkPresentRegionsKHR presentRegions{};
+        std::array<VkRectLayerKHR, DamageRegion::MAX_RECTS> changedRects{};
+        if (damageTracking && m_hasIncrementalPresent && !m_pendingDamage.isFull()) {
+            const VkExtent2D extent = m_swapchain.getExtent();
+            for (const DamageRect& rect : m_pendingDamage.getRects()) {
+                const DamageRect visible = rect.clipped(extent.width, extent.height);
+                if (visible.isEmpty()) continue;
+                changedRects[presentRegion.rectangleCount++] = {{visible.x, visible.y}, {visible.width, visible.height}, 0};
+            }
+            presentRegion.pRectangles = changedRects.data();
+
+            presentRegions.sType = VK_STRUCTURE_TYPE_PRESENT_REGIONS_KHR;
+            presentRegions.swapchainCount = 1;
+            presentRegions.pRegions = &presentRegion;
+            presentRegions.pNext = presentChain;
+            presentChain = &presentRegions;
+        }
+        presentInfo.pNext = presentChain;
+
+        VkResult presentResult;
+        {
+            PROFILE_SCOPE("present");
+            presentResult = vkQueuePresentKHR(m_presentQueue, &presentInfo);
+        }
+        m_presentId = presentId;
+        m_pendingDamage.clear();//recreation below puts back whatever has to be redrawn
+
+        if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR) {
             recreateSwapchain();
         } else if (presentResult != VK_SUCCESS) {
             throw std::runtime_error("Failed to present swapchain image!");
@@ -629,22 +1221,241 @@ namespace Coreful::renderer::vulkan {
 
     }
 
+    void VulkanRenderer::resize(const uint32_t width, const uint32_t height) {
+        if (m_headless) return;
 
+        m_windowWidth = width;
+        m_windowHeight = height;
+        if (width == m_swapchain.getExtent().width && height == m_swapchain.getExtent().height) return;
+        m_resizeRequested = true;
+    }
 
-    void VulkanRenderer::cleanup() {
+    void VulkanRenderer::setPresentMode(const PresentMode mode) {
+        m_requestedPresentMode.store(mode, std::memory_order_relaxed);
+    }
 
-        if (m_hasSwapchainMaintenance1) {
-            for (const auto fence : m_presentFences) {
-                vkDestroyFence(m_device, fence, nullptr);
+    void VulkanRenderer::setPreferredDevice(const std::string& nameOrUUID) {
+        m_preferredDevice = nameOrUUID;
+    }
+
+    void VulkanRenderer::setLowLatency(const bool enabled) {
+        m_lowLatency.store(enabled, std::memory_order_relaxed);
+    }
+
+    void VulkanRenderer::waitForFrame(const uint64_t frameNumber) {
+        if (frameNumber <= m_completedFrame) return;
+
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &m_frameTimeline;
+        waitInfo.pValues = &frameNumber;
+
+        if (vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to wait for frame timeline!");
+        }
+        m_completedFrame = frameNumber;
+    }
+
+    void VulkanRenderer::retire(const uint64_t extraFrames, std::function<void()> destroy) {
+        //the frame being recorded right now may still use it
+        m_deletionQueue.push(m_submittedFrame + 1 + extraFrames, std::move(destroy));
+    }
+
+    VkFence VulkanRenderer::acquirePresentFence() {
+        VkFence fence;
+        if (!m_freePresentFences.empty()) {
+            fence = m_freePresentFences.back();
+            m_freePresentFences.pop_back();
+            vkResetFences(m_device, 1, &fence);
+        }else {
+            VkFenceCreateInfo fenceInfo{};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            if (vkCreateFence(m_device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create present fence!");
             }
         }
 
-        vkDeviceWaitIdle(m_device);
+        //an out of date present still counts as queued, so its fence is signaled like any other
+        m_presentFences.push_back(fence);
+        return fence;
+    }
 
-        for (const auto framebuffer : m_framebuffers) {
-            vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+    void VulkanRenderer::releasePresentFences() {
+        const auto isSignaled = [this](const VkFence fence) {return vkGetFenceStatus(m_device, fence) == VK_SUCCESS;};
+
+        std::erase_if(m_presentFences, [&](const VkFence fence) {
+            if (!isSignaled(fence)) return false;
+            m_freePresentFences.push_back(fence);
+            return true;
+        });
+
+        std::erase_if(m_retiredSwapchains, [&](const RetiredSwapchain& retired) {
+            if (!std::ranges::all_of(retired.presentFences, isSignaled)) return false;
+            retired.destroy();
+            m_freePresentFences.insert(m_freePresentFences.end(), retired.presentFences.begin(), retired.presentFences.end());
+            return true;
+        });
+    }
+
+    void VulkanRenderer::cleanupPresentFences() {
+        //the device is idle, but the presentation engine may still hold a semaphore for a moment
+        std::vector<VkFence> pending = m_presentFences;
+        for (const RetiredSwapchain& retired : m_retiredSwapchains) {
+            pending.insert(pending.end(), retired.presentFences.begin(), retired.presentFences.end());
+        }
+        if (!pending.empty()) {
+            vkWaitForFences(m_device, static_cast<uint32_t>(pending.size()), pending.data(), VK_TRUE, PRESENT_WAIT_TIMEOUT_NS);
+        }
+
+        for (const RetiredSwapchain& retired : m_retiredSwapchains) retired.destroy();
+        m_retiredSwapchains.clear();
+
+        pending.insert(pending.end(), m_freePresentFences.begin(), m_freePresentFences.end());
+        for (const auto fence : pending) vkDestroyFence(m_device, fence, nullptr);
+        m_presentFences.clear();
+        m_freePresentFences.clear();
+    }
+
+    void VulkanRenderer::setDamageTracking(const bool enabled) {
+        m_damageTracking.store(enabled, std::memory_order_relaxed);
+    }
+
+    void VulkanRenderer::addDamage(const DamageRect& rect) {
+        m_pendingDamage.add(rect);
+    }
+
+    void VulkanRenderer::invalidate() {
+        m_pendingDamage.markFull();
+    }
+
+    bool VulkanRenderer::needsRedraw() const {
+        return m_headless || m_resizeRequested || !m_damageTracking.load(std::memory_order_relaxed) || !m_pendingDamage.isEmpty();
+    }
+
+    void VulkanRenderer::resetImageDamage() {
+        //new images have no contents worth keeping
+        DamageRegion full;
+        full.markFull();
+        m_imageDamage.assign(m_swapchain.getImageCount(), full);
+        m_pendingDamage.markFull();
+    }
+
+    void VulkanRenderer::applyPresentMode(const PresentMode mode) {
+        m_presentMode = mode;
+        if (m_headless) return;
+
+        //the surface may not offer it at all, the swapchain falls back to fifo then
+        const VkPresentModeKHR presentMode = toVkPresentMode(mode);
+        if (m_swapchain.canSwitchTo(presentMode)) {
+            m_activePresentMode = presentMode;
+            LOG_DEBUGF("Present mode switched to {} without recreating the swapchain", static_cast<int>(presentMode));
+            return;
+        }
+        m_resizeRequested = true;
+    }
+
+    void VulkanRenderer::waitForQueuedFrames() {
+        PROFILE_SCOPE("wait queued frames");
+
+        if (m_waitForPresent) {
+            if (m_presentId < LOW_LATENCY_QUEUED_FRAMES) return;
+
+            //bounded, a hidden window may never present, that is no reason to freeze
+            const VkResult result = m_waitForPresent(m_device, m_swapchain.get(), m_presentId - LOW_LATENCY_QUEUED_FRAMES + 1, PRESENT_WAIT_TIMEOUT_NS);
+            if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_ERROR_SURFACE_LOST_KHR) m_resizeRequested = true;
+            return;
+        }
+
+        //without present wait, at least keep the gpu from running a frame ahead
+        waitForFrame(m_submittedFrame);
+    }
+
+    VkPresentModeKHR VulkanRenderer::toVkPresentMode(const PresentMode mode) {
+        switch (mode) {
+            case PresentMode::FifoRelaxed: return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+            case PresentMode::Mailbox: return VK_PRESENT_MODE_MAILBOX_KHR;
+            case PresentMode::Immediate: return VK_PRESENT_MODE_IMMEDIATE_KHR;
+            case PresentMode::Fifo:
+            default: return VK_PRESENT_MODE_FIFO_KHR;
+        }
+    }
+
+    void VulkanRenderer::renderOffscreen() {
+
+        //no acquire or present, every frame in flight owns its target
+        const auto targetIndex = static_cast<uint32_t>(m_currentFrame);
+
+        m_uploader.flush();
+        m_uploader.takePending(targetIndex);
+
+        vkResetCommandPool(m_device, m_commandPools[m_currentFrame], 0);
+        DamageRegion damage;
+        damage.markFull();//the readback copies the whole target
+        recordCommandBuffers(m_commandBuffers[m_currentFrame], targetIndex, damage);
+
+        const uint64_t frameNumber = m_submittedFrame + 1;
+
+        VkTimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+        timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineSubmitInfo.signalSemaphoreValueCount = 1;
+        timelineSubmitInfo.pSignalSemaphoreValues = &frameNumber;
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineSubmitInfo;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &m_commandBuffers[m_currentFrame];
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &m_frameTimeline;
+
+        const std::vector<VkSemaphore>& waitSemaphores = m_uploader.getWaitSemaphores(targetIndex);
+        const std::vector<VkPipelineStageFlags> waitStages(waitSemaphores.size(), VulkanUploader::WAIT_STAGE);
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        submitInfo.pWaitSemaphores = waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
+
+        if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to submit offscreen command buffer!");
         }
+        m_submittedFrame = frameNumber;
+        m_frameNumbers[m_currentFrame] = frameNumber;
+
+        m_lastOffscreenTarget = targetIndex;
+        m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    }
+
+    bool VulkanRenderer::readPixels(std::vector<uint8_t>& pixels) {
+        if (!m_headless || !m_lastOffscreenTarget.has_value()) return false;
+
+        const uint32_t targetIndex = m_lastOffscreenTarget.value();
+        waitForFrame(m_frameNumbers[targetIndex]);
+
+        m_offscreenTargets.readPixels(targetIndex, pixels);
+        return true;
+    }
+
+
+
+    bool VulkanRenderer::getGpuTimings(const uint32_t framesAgo, GpuFrameTimings& timings) const {
+        return m_gpuProfiler.getFrameTimings(framesAgo, timings);
+    }
+
+    void VulkanRenderer::cleanup() {
+
+        vkDeviceWaitIdle(m_device);
+        m_deletionQueue.flushAll();
+        cleanupPresentFences();
+
+        cleanupFramebuffers();
+        if (m_headless) m_offscreenTargets.cleanup();
+        else m_swapchain.cleanup(m_device);
+        m_quadBatch.cleanup();
+        m_textureTable.cleanup();
+        m_uploader.cleanup();
+        m_gpuProfiler.cleanup(m_device);
         vkDestroyRenderPass(m_device, m_renderPass, nullptr);
+        vkDestroyRenderPass(m_device, m_loadRenderPass, nullptr);
         vkDestroyPipeline(m_device, m_graphicsPipeline, nullptr);
         vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
 
@@ -652,12 +1463,20 @@ namespace Coreful::renderer::vulkan {
             vkDestroySemaphore(m_device, semaphore, nullptr);
         }
 
-        for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            vkDestroySemaphore(m_device, m_imageAvailableSemaphores[i], nullptr);
-            vkDestroySemaphore(m_device, m_renderFinishedSemaphores[i], nullptr);
-            vkDestroyFence(m_device, m_inFlightFences[i], nullptr);
+        for (const auto semaphore : m_imageAvailableSemaphores) {
+            vkDestroySemaphore(m_device, semaphore, nullptr);
+        }
+        vkDestroySemaphore(m_device, m_frameTimeline, nullptr);
+        for (const auto commandPool : m_commandPools) {
+            vkDestroyCommandPool(m_device, commandPool, nullptr);//frees its command buffers too
         }
-        vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+        m_secondaryCommandBuffers.cleanup(m_device);
+
+        m_renderGraph.cleanup();
+        m_allocator.cleanup();//after everything that was allocated from it
+
+        m_pipelineCache.save(m_device);
+        m_pipelineCache.cleanup(m_device);
 
         if (m_device != VK_NULL_HANDLE) vkDestroyDevice(m_device, nullptr);
         if (m_surface != VK_NULL_HANDLE) vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
@@ -666,46 +1485,60 @@ namespace Coreful::renderer::vulkan {
     }
 
 
-    void VulkanRenderer::recreateSwapchain() {
-        uint32_t width = 0, height = 0;
+    bool VulkanRenderer::recreateSwapchain() {
+        PROFILE_SCOPE("recreate swapchain");
 
-        while (width == 0 || height == 0) {
-            width = m_window->getWidth().raw();
-            height = m_window->getHeight().raw();
+        //the window's messages belong to whichever thread owns it, so a zero size is retried on a later frame
+        m_resizeRequested = m_windowWidth == 0 || m_windowHeight == 0;
+        if (m_resizeRequested) return false;
 
-            m_window->processMessages();
-
-        }
-
-        vkDeviceWaitIdle(m_device);
+        //no device wait, frames still in flight keep drawing into the old images while the new swapchain is built
+        const VulkanSwapchain retiredSwapchain = m_swapchain;
+        const std::vector retiredFramebuffers = std::move(m_framebuffers);
+        const std::vector retiredSemaphores = std::move(m_renderFinishedSemaphoresPerImage);
+        m_framebuffers.clear();
+        m_renderFinishedSemaphoresPerImage.clear();
 
-        cleanupFramebuffers();
         cleanupDepthResources();
-        m_swapchain.cleanup(m_device);
 
         m_swapchain.init(
             m_physicalDevice,
             m_device,
             m_surface,
-            width,
-            height,
+            m_windowWidth,
+            m_windowHeight,
             m_queueFamilyIndices.graphicsFamily.value(),
-            m_queueFamilyIndices.presentFamily.value()
+            m_queueFamilyIndices.presentFamily.value(),
+            toVkPresentMode(m_presentMode),
+            m_hasSwapchainMaintenance1,
+            retiredSwapchain.get()
             );
+        m_activePresentMode = m_swapchain.getPresentMode();
+        m_presentId = 0;//ids are per swapchain
 
-        createDepthResources();
-        createFramebuffers();
-
-        vkFreeCommandBuffers(m_device, m_commandPool, static_cast<uint32_t>(m_commandBuffers.size()), m_commandBuffers.data());
-
-        createCommandBuffers();
+        auto destroy = [device = m_device, retiredSwapchain, retiredFramebuffers, retiredSemaphores] {
+            for (const auto framebuffer : retiredFramebuffers) vkDestroyFramebuffer(device, framebuffer, nullptr);
+            for (const auto semaphore : retiredSemaphores) vkDestroySemaphore(device, semaphore, nullptr);
+            retiredSwapchain.cleanup(device);
+        };
 
-        for (size_t i = 0; i < m_commandBuffers.size(); i++) {
-            recordCommandBuffers(m_commandBuffers[i], static_cast<uint32_t>(i));
+        //the timeline only covers rendering, presents of the old images may still wait on their semaphores
+        if (m_hasSwapchainMaintenance1) {
+            //rendering into the framebuffers is covered too, every frame that did is presented before its fence signals
+            m_retiredSwapchains.push_back({std::move(m_presentFences), std::move(destroy)});
+            m_presentFences.clear();
+        }else {
+            //no way to know when they are done, keep everything around until the frames after them have gone through as well
+            retire(MAX_FRAMES_IN_FLIGHT, std::move(destroy));
         }
 
-        m_imagesInFlight.clear();
-        m_imagesInFlight.resize(m_swapchain.getImageCount(), VK_NULL_HANDLE);
+        createDepthResources();
+        createFramebuffers();
+        createPerImageSemaphores();
+
+        m_imageFrames.assign(m_swapchain.getImageCount(), 0);
+        resetImageDamage();
+        return true;
 
     }
 
@@ -735,24 +1568,52 @@ namespace Coreful::renderer::vulkan {
         std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
         vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
+        std::optional<uint32_t> transferComputeFamily;
+
         for (uint32_t i = 0; i < queueFamilyCount; i++) {
-            if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            const VkQueueFlags flags = queueFamilies[i].queueFlags;
+
+            if (flags & VK_QUEUE_GRAPHICS_BIT && !indices.graphicsFamily.has_value()) {
                 indices.graphicsFamily = i;
             }
 
             VkBool32 presentSupport = VK_FALSE;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-
-            if (presentSupport) indices.presentFamily = i;
+            if (surface != VK_NULL_HANDLE) {
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            }else if (flags & VK_QUEUE_GRAPHICS_BIT) {
+                presentSupport = VK_TRUE;//headless, nothing gets presented so the graphics queue stands in
+            }
 
-            if (indices.isComplete()) break;
+            if (presentSupport && !indices.presentFamily.has_value()) indices.presentFamily = i;
 
+            //a pure transfer family is usually backed by the copy engines, async compute families are the fallback
+            if (flags & VK_QUEUE_TRANSFER_BIT && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+                if (!(flags & VK_QUEUE_COMPUTE_BIT)) {
+                    if (!indices.transferFamily.has_value()) indices.transferFamily = i;
+                } else if (!transferComputeFamily.has_value()) {
+                    transferComputeFamily = i;
+                }
+            }
         }
 
+        if (!indices.transferFamily.has_value()) indices.transferFamily = transferComputeFamily;
+
         return indices;
 
     }
 
+    VkImage VulkanRenderer::getColorImage(const uint32_t imageIndex) const {
+        return m_headless ? m_offscreenTargets.getTarget(imageIndex).image : m_swapchain.getImages()[imageIndex];
+    }
+
+    VkFormat VulkanRenderer::getColorFormat() const {
+        return m_headless ? m_offscreenTargets.getImageFormat() : m_swapchain.getImageFormat();
+    }
+
+    VkExtent2D VulkanRenderer::getRenderExtent() const {
+        return m_headless ? m_offscreenTargets.getExtent() : m_swapchain.getExtent();
+    }
+
     bool VulkanRenderer::checkValidationLayerSupport() {
         uint32_t layerCount;
         vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
@@ -773,20 +1634,4 @@ namespace Coreful::renderer::vulkan {
         return true;
     }
 
-    std::vector<char> VulkanRenderer::readFile(const std::string &filename) {
-        std::ifstream file(filename, std::ios::ate | std::ios::binary); // open at end to get size
-
-        if (!file.is_open()) {
-            throw std::runtime_error("Failed to open shader file!");
-        }
-
-        const size_t fileSize = file.tellg();
-        std::vector<char> buffer(fileSize);
-
-        file.seekg(0);
-        file.read(buffer.data(), static_cast<std::streamsize>(fileSize));
-        file.close();
-
-        return buffer;
-    }
 }
\ No newline at end of file
@@ -1,20 +1,54 @@
 #pragma once
-
+#include <array>
+#include <atomic>
+#include <span>
+
+#include "VulkanAllocator.h"
+#include "VulkanDeletionQueue.h"
+#include "VulkanDeviceSelector.h"
+#include "VulkanGpuProfiler.h"
+#include "VulkanOffscreenTargets.h"
+#include "VulkanPipelineCache.h"
+#include "VulkanQuadBatch.h"
 #include "VulkanQueues.h"
+#include "VulkanRenderGraph.h"
+#include "VulkanSecondaryCommandBuffers.h"
 #include "VulkanSwapchain.h"
+#include "VulkanTextureTable.h"
+#include "VulkanUploader.h"
 #include "renderer/Renderer.h"
 
 #include "platform/PlatformWindow.h"
 
 #include "VulkanPlatform.h"
 
+namespace Coreful {
+    class JobSystem;
+}
+
 namespace Coreful::renderer::vulkan {
     class VulkanRenderer final : public Renderer {
 
     public:
 
+        //with a job system, large frames are recorded in parallel into secondary command buffers
+        explicit VulkanRenderer(JobSystem* jobSystem = nullptr) : m_jobSystem(jobSystem) {}
+
         void init(PlatformWindow& window) override;
+        void initHeadless(uint32_t width, uint32_t height) override;
+        void beginFrame() override;
+        void submitQuad(const QuadInstance& quad) override;
         void render() override;
+        void resize(uint32_t width, uint32_t height) override;
+        void setPresentMode(PresentMode mode) override;
+        void setLowLatency(bool enabled) override;
+        void setPreferredDevice(const std::string& nameOrUUID) override;
+        void setDamageTracking(bool enabled) override;
+        void addDamage(const DamageRect& rect) override;
+        void invalidate() override;
+        [[nodiscard]] bool needsRedraw() const override;
+        bool readPixels(std::vector<uint8_t>& pixels) override;
+        bool getGpuTimings(uint32_t framesAgo, GpuFrameTimings& timings) const override;
         void cleanup() override;
 
         //[[nodiscard]] PlatformWindow& getWindow() const {return *m_window;}
@@ -24,40 +58,101 @@ namespace Coreful::renderer::vulkan {
         VkInstance m_instance = VK_NULL_HANDLE;
         VkSurfaceKHR m_surface = VK_NULL_HANDLE;
         VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;//the gpu
+        std::string m_preferredDevice;
         VkDevice m_device = VK_NULL_HANDLE;
+        VulkanAllocator m_allocator;
+        VulkanRenderGraph m_renderGraph;
         VkQueue m_graphicsQueue = VK_NULL_HANDLE;
         VkQueue m_presentQueue = VK_NULL_HANDLE;
+        VkQueue m_transferQueue = VK_NULL_HANDLE;//same as the graphics queue without a transfer family
         QueueFamilyIndices m_queueFamilyIndices;
         VulkanSwapchain m_swapchain;
         VkRenderPass m_renderPass = VK_NULL_HANDLE;
+        VkRenderPass m_loadRenderPass = VK_NULL_HANDLE;//compatible with m_renderPass, keeps the previous contents
         std::vector<VkFramebuffer> m_framebuffers;
-        VkCommandPool m_commandPool = VK_NULL_HANDLE;
-        std::vector<VkCommandBuffer> m_commandBuffers;
+
+        //with dynamic rendering there are no render passes or framebuffers, rendering begins on the image views
+        bool m_dynamicRendering = false;
+        PFN_vkCmdBeginRendering m_cmdBeginRendering = nullptr;//core or KHR, whichever the device has
+        PFN_vkCmdEndRendering m_cmdEndRendering = nullptr;
+        PFN_vkCmdPipelineBarrier2 m_cmdPipelineBarrier2 = nullptr;//null without synchronization2
+        std::vector<VkCommandPool> m_commandPools;//one transient pool per frame in flight, reset as a whole
+        std::vector<VkCommandBuffer> m_commandBuffers;//indexed by m_currentFrame
+        VulkanSecondaryCommandBuffers m_secondaryCommandBuffers;
+        JobSystem* m_jobSystem = nullptr;
+
+        constexpr static uint32_t MAX_RECORDING_CHUNKS = 8;
+        constexpr static uint32_t MIN_QUADS_PER_CHUNK = 2048;//smaller frames are recorded inline, one draw is cheaper than a job
 
 
         constexpr static int MAX_FRAMES_IN_FLIGHT = 2;
 
 
-        std::vector<VkSemaphore> m_imageAvailableSemaphores;
-        std::vector<VkSemaphore> m_renderFinishedSemaphores;
+        //frame n signals n on the timeline, the binary semaphores are only there because acquire and present need them
+        VkSemaphore m_frameTimeline = VK_NULL_HANDLE;
+        std::vector<VkSemaphore> m_imageAvailableSemaphores;//per frame slot
         std::vector<VkSemaphore> m_renderFinishedSemaphoresPerImage;
-        std::vector<VkFence> m_inFlightFences;
-        std::vector<VkFence> m_imagesInFlight;
+        std::vector<uint64_t> m_imageFrames;//per swapchain image, the last frame that drew into it
 
         size_t m_currentFrame = 0;
 
-        VkSemaphore m_imageAvailableSemaphore = VK_NULL_HANDLE;
-        VkSemaphore m_renderFinishedSemaphore = VK_NULL_HANDLE;
-        VkFence m_inFlightFence = VK_NULL_HANDLE;
+        //frames are numbered from 1 as they are submitted, retired resources wait for the timeline to pass theirs
+        uint64_t m_submittedFrame = 0;
+        uint64_t m_completedFrame = 0;//last timeline value seen
+        std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> m_frameNumbers{};//last frame submitted from each slot
+        VulkanDeletionQueue m_deletionQueue;
 
         VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
         VkPipeline m_graphicsPipeline = VK_NULL_HANDLE;
+        VulkanPipelineCache m_pipelineCache;
 
+        bool m_hasSurfaceMaintenance1 = false;
         bool m_hasSwapchainMaintenance1 = false;
-        std::vector<VkFence> m_presentFences;
+
+        //with swapchain maintenance1 every present signals a fence once the presentation engine is done with its semaphore,
+        //a replaced swapchain is destroyed once all of its presents have, without it a few extra frames have to do
+        struct RetiredSwapchain {
+            std::vector<VkFence> presentFences;
+            std::function<void()> destroy;
+        };
+        std::vector<VkFence> m_presentFences;//presents to the current swapchain that may still be pending
+        std::vector<VkFence> m_freePresentFences;
+        std::vector<RetiredSwapchain> m_retiredSwapchains;
+
+        //present modes, the requested one is picked up by the render thread on its next frame
+        std::atomic<PresentMode> m_requestedPresentMode = PresentMode::Mailbox;
+        PresentMode m_presentMode = PresentMode::Mailbox;
+        VkPresentModeKHR m_activePresentMode = VK_PRESENT_MODE_FIFO_KHR;//what the surface actually gave us
+
+        //low latency, null without present id and present wait
+        std::atomic<bool> m_lowLatency = false;
+        PFN_vkWaitForPresentKHR m_waitForPresent = nullptr;
+        uint64_t m_presentId = 0;//last id presented to the current swapchain
+
+        constexpr static uint64_t LOW_LATENCY_QUEUED_FRAMES = 1;
+
+        //damage tracking, only the render thread touches the regions
+        std::atomic<bool> m_damageTracking = false;
+        bool m_hasIncrementalPresent = false;
+        DamageRegion m_pendingDamage;//added since the last present
+        std::vector<DamageRegion> m_imageDamage;//per swapchain image, what it misses since it was last drawn
+        constexpr static uint64_t PRESENT_WAIT_TIMEOUT_NS = 100'000'000;
 
         PlatformWindow *m_window = nullptr;
 
+        VulkanQuadBatch m_quadBatch;
+        VulkanUploader m_uploader;
+        VulkanTextureTable m_textureTable;
+        VulkanGpuProfiler m_gpuProfiler;
+        bool m_frameBegun = false;
+        bool m_resizeRequested = false;
+        uint32_t m_windowWidth = 0, m_windowHeight = 0;//last size given to resize(), the window itself may live on another thread
+
+        //headless mode
+        bool m_headless = false;
+        VulkanOffscreenTargets m_offscreenTargets;
+        std::optional<uint32_t> m_lastOffscreenTarget;
+
 
 
         //INITIALIZATION FUNCTIONS
@@ -65,23 +160,51 @@ namespace Coreful::renderer::vulkan {
         void createSurface(const PlatformWindow& window);
         void pickPhysicalDevice();//locate and select gpu for vulkan
         void createLogicalDevice();
+        void createAllocator();
+        void createRenderGraph();
+        void createPipelineCache();
         void createSyncObjects();
         void initializeSwapchain(const PlatformWindow& window);
+        void createPerImageSemaphores();
+        void createOffscreenTargets(uint32_t width, uint32_t height);
         void createRenderPass();
         void createDepthResources();
         void createFramebuffers();
         void createCommandPool();
         void createCommandBuffers();
-        void recordCommandBuffers(VkCommandBuffer commandBuffer, uint32_t imageIndex) const;
-        [[nodiscard]] VkShaderModule createShaderModule(const std::vector<char>& code) const;
+        void createQuadBatch();
+        void createUploader();
+        void createTextureTable();
+        void createGpuProfiler();
+        void recordCommandBuffers(VkCommandBuffer commandBuffer, uint32_t imageIndex, const DamageRegion& damage);
+        void recordDrawState(VkCommandBuffer commandBuffer, VkExtent2D extent, VkRect2D scissor) const;
+        //a render pass, or dynamic rendering, the render graph takes care of the layout transitions around it
+        void beginRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex, VkRect2D area, bool partial, bool secondaryContents) const;
+        void endRendering(VkCommandBuffer commandBuffer) const;
+        static void recordClear(VkCommandBuffer commandBuffer, VkRect2D area);
+        [[nodiscard]] VkShaderModule createShaderModule(std::span<const uint32_t> code) const;
         void createGraphicsPipeline();
 
         //HELPER FUNCTIONS
+        void renderOffscreen();
+        [[nodiscard]] VkImage getColorImage(uint32_t imageIndex) const;
+        [[nodiscard]] VkFormat getColorFormat() const;
+        [[nodiscard]] VkExtent2D getRenderExtent() const;
         void cleanupFramebuffers();
         void cleanupDepthResources();
-        void recreateSwapchain();
+        bool recreateSwapchain();//false while the window has no area
+        void waitForFrame(uint64_t frameNumber);
+        //destroy runs once the gpu is done with every frame recorded so far, plus extraFrames more
+        void retire(uint64_t extraFrames, std::function<void()> destroy);
+        [[nodiscard]] VkFence acquirePresentFence();
+        //recycles the fences of finished presents and destroys retired swapchains none of whose presents are pending
+        void releasePresentFences();
+        void cleanupPresentFences();
+        void applyPresentMode(PresentMode mode);
+        void resetImageDamage();
+        void waitForQueuedFrames();
+        static VkPresentModeKHR toVkPresentMode(PresentMode mode);
         static bool checkValidationLayerSupport();
-        static std::vector<char> readFile(const std::string& filename);
         static QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface);
 
 
@@ -0,0 +1,102 @@
+
+#include "VulkanSecondaryCommandBuffers.h"
+
+#include <stdexcept>
+
+#include "util/Logger.h"
+
+namespace Coreful::renderer::vulkan {
+
+    void VulkanSecondaryCommandBuffers::init(const VkDevice device, const uint32_t queueFamily, const uint32_t frameCount, const uint32_t chunkCount) {
+        m_chunkCount = chunkCount;
+        if (chunkCount == 0) return;
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = queueFamily;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;//re-recorded every frame
+
+        m_frames.resize(frameCount);
+        for (auto& frame : m_frames) {
+            frame.commandPools.resize(chunkCount);
+            frame.commandBuffers.resize(chunkCount);
+
+            for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+                if (vkCreateCommandPool(device, &poolInfo, nullptr, &frame.commandPools[chunk]) != VK_SUCCESS) {
+                    throw std::runtime_error("Failed to create secondary command pool!");
+                }
+
+                VkCommandBufferAllocateInfo allocInfo{};
+                allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+                allocInfo.commandPool = frame.commandPools[chunk];
+                allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+                allocInfo.commandBufferCount = 1;
+
+                if (vkAllocateCommandBuffers(device, &allocInfo, &frame.commandBuffers[chunk]) != VK_SUCCESS) {
+                    throw std::runtime_error("Failed to allocate secondary command buffer!");
+                }
+            }
+        }
+
+        LOG_DEBUGF("Secondary Command Buffers Created! ({} chunks)", chunkCount);
+    }
+
+    void VulkanSecondaryCommandBuffers::cleanup(const VkDevice device) {
+        for (const auto& frame : m_frames) {
+            for (const auto commandPool : frame.commandPools) {
+                vkDestroyCommandPool(device, commandPool, nullptr);//frees its command buffers too
+            }
+        }
+        m_frames.clear();
+        m_chunkCount = 0;
+    }
+
+    void VulkanSecondaryCommandBuffers::reset(const VkDevice device, const uint32_t frameIndex) const {
+        if (m_frames.empty()) return;
+
+        for (const auto commandPool : m_frames[frameIndex].commandPools) {
+            vkResetCommandPool(device, commandPool, 0);
+        }
+    }
+
+    VkCommandBuffer VulkanSecondaryCommandBuffers::begin(const uint32_t frameIndex, const uint32_t chunk, const VkRenderPass renderPass,
+                                                         const VkFramebuffer framebuffer) const {
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = renderPass;
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = framebuffer;
+
+        return begin(frameIndex, chunk, inheritanceInfo);
+    }
+
+    VkCommandBuffer VulkanSecondaryCommandBuffers::beginRendering(const uint32_t frameIndex, const uint32_t chunk, const VkFormat colorFormat) const {
+        //has to match what the primary passes to vkCmdBeginRendering
+        VkCommandBufferInheritanceRenderingInfo renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachmentFormats = &colorFormat;
+        renderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.pNext = &renderingInfo;
+
+        return begin(frameIndex, chunk, inheritanceInfo);
+    }
+
+    VkCommandBuffer VulkanSecondaryCommandBuffers::begin(const uint32_t frameIndex, const uint32_t chunk, const VkCommandBufferInheritanceInfo& inheritanceInfo) const {
+        VkCommandBuffer commandBuffer = m_frames[frameIndex].commandBuffers[chunk];
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to begin secondary command buffer!");
+        }
+        return commandBuffer;
+    }
+
+}
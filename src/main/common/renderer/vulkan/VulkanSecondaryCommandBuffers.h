@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Coreful::renderer::vulkan {
+
+    //one transient pool and secondary buffer per recording chunk and frame in flight,
+    //so every chunk can be recorded on its own thread without sharing a pool
+    class VulkanSecondaryCommandBuffers {
+
+    public:
+
+        void init(VkDevice device, uint32_t queueFamily, uint32_t frameCount, uint32_t chunkCount);
+        void cleanup(VkDevice device);
+
+        //the frame has finished on the gpu, its buffers can be recorded again
+        void reset(VkDevice device, uint32_t frameIndex) const;
+
+        //begins recording chunk as a continuation of subpass 0 of renderPass
+        VkCommandBuffer begin(uint32_t frameIndex, uint32_t chunk, VkRenderPass renderPass, VkFramebuffer framebuffer) const;
+        //begins recording chunk as a continuation of dynamic rendering into one color attachment
+        VkCommandBuffer beginRendering(uint32_t frameIndex, uint32_t chunk, VkFormat colorFormat) const;
+
+        [[nodiscard]] const std::vector<VkCommandBuffer>& getCommandBuffers(uint32_t frameIndex) const {return m_frames[frameIndex].commandBuffers;}
+        [[nodiscard]] uint32_t getChunkCount() const {return m_chunkCount;}
+
+    private:
+
+        struct FrameBuffers {
+            std::vector<VkCommandPool> commandPools;
+            std::vector<VkCommandBuffer> commandBuffers;
+        };
+
+        std::vector<FrameBuffers> m_frames;
+        uint32_t m_chunkCount = 0;
+
+        VkCommandBuffer begin(uint32_t frameIndex, uint32_t chunk, const VkCommandBufferInheritanceInfo& inheritanceInfo) const;
+
+    };
+
+}
@@ -15,15 +15,28 @@ namespace Coreful::renderer::vulkan {
         VkSurfaceKHR surface,
         uint32_t width, uint32_t height,
         const uint32_t graphicsQueueFamily,
-        const uint32_t presentQueueFamily){
+        const uint32_t presentQueueFamily,
+        const VkPresentModeKHR presentMode,
+        const bool switchablePresentModes,
+        const VkSwapchainKHR oldSwapchain){
 
         const auto [capabilities, formats, presentModes] = querySupport(physicalDevice, surface);
         auto [format, colorSpace] = chooseSwapSurfaceFormat(formats);
-        const VkPresentModeKHR presentMode = chooseSwapPresentMode(presentModes);
+        m_presentMode = chooseSwapPresentMode(presentModes, presentMode);
         m_extent = chooseSwapExtent(capabilities, width, height);
         m_imageFormat = format;
 
-        uint32_t imageCount = capabilities.minImageCount + 1;
+        uint32_t minImageCount = capabilities.minImageCount;
+        m_compatiblePresentModes.clear();
+        if (switchablePresentModes) {
+            m_compatiblePresentModes = queryCompatiblePresentModes(physicalDevice, surface, m_presentMode);
+            //the swapchain has to satisfy whichever of them ends up being used
+            for (const auto mode : m_compatiblePresentModes) {
+                minImageCount = std::max(minImageCount, queryMinImageCount(physicalDevice, surface, mode));
+            }
+        }
+
+        uint32_t imageCount = minImageCount + 1;
         if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount) {
             imageCount = capabilities.maxImageCount;
         }
@@ -49,8 +62,17 @@ namespace Coreful::renderer::vulkan {
 
         createInfo.preTransform = capabilities.currentTransform;
         createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-        createInfo.presentMode = presentMode;
+        createInfo.presentMode = m_presentMode;
         createInfo.clipped = VK_TRUE;
+        createInfo.oldSwapchain = oldSwapchain;//lets the driver hand over resources instead of starting cold
+
+        VkSwapchainPresentModesCreateInfoEXT presentModesInfo{};
+        if (!m_compatiblePresentModes.empty()) {
+            presentModesInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_PRESENT_MODES_CREATE_INFO_EXT;
+            presentModesInfo.presentModeCount = static_cast<uint32_t>(m_compatiblePresentModes.size());
+            presentModesInfo.pPresentModes = m_compatiblePresentModes.data();
+            createInfo.pNext = &presentModesInfo;
+        }
 
         if (VkResult result = vkCreateSwapchainKHR(device, &createInfo, nullptr, &m_swapchain); result != VK_SUCCESS) {
             log(Logger::LogType::Error, "vkCreateSwapchainKHR failed! with code: ", result);
@@ -121,18 +143,70 @@ namespace Coreful::renderer::vulkan {
         return availableSurfaceFormats[0];
     }
 
-    VkPresentModeKHR VulkanSwapchain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
+    VkPresentModeKHR VulkanSwapchain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes, const VkPresentModeKHR requested) {
 
         if (availablePresentModes.empty()) throw std::runtime_error("No supported present modes!");
 
-        for (const auto& availablePresentMode : availablePresentModes) {
-            if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-                return availablePresentMode;//triple buffering
-            }
+        if (std::ranges::find(availablePresentModes, requested) != availablePresentModes.end()) {
+            return requested;
         }
+        log(Logger::LogType::Warn, "Present mode ", requested, " not supported by the surface, using fifo");
         return VK_PRESENT_MODE_FIFO_KHR;//guaranteed
     }
 
+    bool VulkanSwapchain::canSwitchTo(const VkPresentModeKHR presentMode) const {
+        return std::ranges::find(m_compatiblePresentModes, presentMode) != m_compatiblePresentModes.end();
+    }
+
+    std::vector<VkPresentModeKHR> VulkanSwapchain::queryCompatiblePresentModes(
+        const VkPhysicalDevice physicalDevice, const VkSurfaceKHR surface, const VkPresentModeKHR presentMode) {
+
+        VkSurfacePresentModeEXT surfacePresentMode{};
+        surfacePresentMode.sType = VK_STRUCTURE_TYPE_SURFACE_PRESENT_MODE_EXT;
+        surfacePresentMode.presentMode = presentMode;
+
+        VkPhysicalDeviceSurfaceInfo2KHR surfaceInfo{};
+        surfaceInfo.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SURFACE_INFO_2_KHR;
+        surfaceInfo.pNext = &surfacePresentMode;
+        surfaceInfo.surface = surface;
+
+        VkSurfacePresentModeCompatibilityEXT compatibility{};
+        compatibility.sType = VK_STRUCTURE_TYPE_SURFACE_PRESENT_MODE_COMPATIBILITY_EXT;
+
+        VkSurfaceCapabilities2KHR capabilities{};
+        capabilities.sType = VK_STRUCTURE_TYPE_SURFACE_CAPABILITIES_2_KHR;
+        capabilities.pNext = &compatibility;
+
+        vkGetPhysicalDeviceSurfaceCapabilities2KHR(physicalDevice, &surfaceInfo, &capabilities);
+
+        std::vector<VkPresentModeKHR> modes(compatibility.presentModeCount);
+        compatibility.pPresentModes = modes.data();
+        vkGetPhysicalDeviceSurfaceCapabilities2KHR(physicalDevice, &surfaceInfo, &capabilities);
+        modes.resize(compatibility.presentModeCount);
+
+        //some drivers leave the mode itself out
+        if (std::ranges::find(modes, presentMode) == modes.end()) modes.push_back(presentMode);
+        return modes;
+    }
+
+    uint32_t VulkanSwapchain::queryMinImageCount(const VkPhysicalDevice physicalDevice, const VkSurfaceKHR surface, const VkPresentModeKHR presentMode) {
+
+        VkSurfacePresentModeEXT surfacePresentMode{};
+        surfacePresentMode.sType = VK_STRUCTURE_TYPE_SURFACE_PRESENT_MODE_EXT;
+        surfacePresentMode.presentMode = presentMode;
+
+        VkPhysicalDeviceSurfaceInfo2KHR surfaceInfo{};
+        surfaceInfo.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SURFACE_INFO_2_KHR;
+        surfaceInfo.pNext = &surfacePresentMode;
+        surfaceInfo.surface = surface;
+
+        VkSurfaceCapabilities2KHR capabilities{};
+        capabilities.sType = VK_STRUCTURE_TYPE_SURFACE_CAPABILITIES_2_KHR;
+
+        vkGetPhysicalDeviceSurfaceCapabilities2KHR(physicalDevice, &surfaceInfo, &capabilities);
+        return capabilities.surfaceCapabilities.minImageCount;
+    }
+
     VkExtent2D VulkanSwapchain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, const uint32_t width, const uint32_t height) {
         if (capabilities.currentExtent.width != UINT32_MAX) {
             return capabilities.currentExtent;
@@ -23,7 +23,10 @@ namespace Coreful::renderer::vulkan {
             VkSurfaceKHR surface,
             uint32_t width, uint32_t height,
             uint32_t graphicsQueueFamily,
-            uint32_t presentQueueFamily
+            uint32_t presentQueueFamily,
+            VkPresentModeKHR presentMode,
+            bool switchablePresentModes,//surface and swapchain maintenance1 are enabled
+            VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE//retired by this call, still has to be destroyed by the caller
             );
 
         void cleanup(VkDevice device) const;
@@ -33,11 +36,15 @@ namespace Coreful::renderer::vulkan {
         [[nodiscard]] VkFormat getImageFormat() const {return m_imageFormat;}
         [[nodiscard]] uint32_t getImageCount() const {return static_cast<uint32_t>(m_images.size());}
         [[nodiscard]] VkExtent2D getExtent() const {return m_extent;}
+        [[nodiscard]] const std::vector<VkImage>& getImages() const {return m_images;}
         [[nodiscard]] const std::vector<VkImageView>& getImageViews() const {return m_imageViews;}
+        [[nodiscard]] VkPresentModeKHR getPresentMode() const {return m_presentMode;}
+        //true when presentMode can be picked per present with VkSwapchainPresentModeInfoEXT
+        [[nodiscard]] bool canSwitchTo(VkPresentModeKHR presentMode) const;
 
         static SwapchainSupportDetails querySupport(VkPhysicalDevice device, VkSurfaceKHR surface);
         static VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableSurfaceFormats);
-        static VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+        static VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes, VkPresentModeKHR requested);
         static VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, uint32_t width, uint32_t height);
 
     private:
@@ -47,6 +54,11 @@ namespace Coreful::renderer::vulkan {
         VkExtent2D m_extent{};
         std::vector<VkImage> m_images;
         std::vector<VkImageView> m_imageViews;
+        VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+        std::vector<VkPresentModeKHR> m_compatiblePresentModes;//includes m_presentMode, empty without maintenance1
+
+        static std::vector<VkPresentModeKHR> queryCompatiblePresentModes(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkPresentModeKHR presentMode);
+        static uint32_t queryMinImageCount(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkPresentModeKHR presentMode);
 
     };
 
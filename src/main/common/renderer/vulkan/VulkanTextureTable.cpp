@@ -0,0 +1,220 @@
+#include "VulkanTextureTable.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "util/Logger.h"
+
+namespace Coreful::renderer::vulkan {
+
+    void VulkanTextureTable::init(const VkPhysicalDevice physicalDevice, const VkDevice device, VulkanAllocator& allocator,
+                                  VulkanUploader& uploader, std::function<void(std::function<void()>)> retire) {
+        m_device = device;
+        m_allocator = &allocator;
+        m_retire = std::move(retire);
+
+        //update-after-bind descriptors have their own, usually far higher, limits
+        VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+        indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &indexingProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+        m_capacity = std::min({MAX_TEXTURES,
+            indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages});
+
+        createSampler();
+        createDescriptorSet();
+        createWhiteTexture(uploader);
+
+        LOG_DEBUGF("Texture Table Created! ({} textures)", m_capacity);
+    }
+
+    void VulkanTextureTable::cleanup() {
+        vkDestroyImageView(m_device, m_whiteImageView, nullptr);
+        m_allocator->destroyImage(m_whiteImage, m_whiteAllocation);
+        vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);//frees the set too
+        vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+        vkDestroySampler(m_device, m_sampler, nullptr);
+
+        m_freeIndices.clear();
+        m_nextIndex = 0;
+    }
+
+    uint32_t VulkanTextureTable::add(const VkImageView imageView) {
+        std::lock_guard lock(m_mutex);
+
+        uint32_t index;
+        if (!m_freeIndices.empty()) {
+            index = m_freeIndices.back();
+            m_freeIndices.pop_back();
+        }else if (m_nextIndex < m_capacity) {
+            index = m_nextIndex++;
+        }else {
+            throw std::runtime_error("Texture table is full!");
+        }
+
+        //update after bind, so frames already recorded don't have to be
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageView = imageView;
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = m_descriptorSet;
+        write.dstBinding = 1;
+        write.dstArrayElement = index;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        write.pImageInfo = &imageInfo;
+
+        vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+        return index;
+    }
+
+    void VulkanTextureTable::remove(const uint32_t index) {
+        if (index == WHITE_TEXTURE) return;
+
+        //the stale descriptor can stay, partially bound arrays only need what is actually sampled to be valid
+        m_retire([this, index] {
+            std::lock_guard lock(m_mutex);
+            m_freeIndices.push_back(index);
+        });
+    }
+
+    // ReSharper disable once CppParameterMayBeConst
+    void VulkanTextureTable::bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) const {
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
+    }
+
+    void VulkanTextureTable::createSampler() {
+        //ui images are drawn close to 1:1, so no mips and no anisotropy
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.anisotropyEnable = VK_FALSE;
+        samplerInfo.maxAnisotropy = 1.0f;
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = 0.0f;
+
+        if (vkCreateSampler(m_device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create texture sampler!");
+        }
+    }
+
+    void VulkanTextureTable::createDescriptorSet() {
+        //binding 0 is the sampler, binding 1 the textures, last so its size can vary
+        VkDescriptorSetLayoutBinding bindings[2]{};
+        bindings[0].binding = 0;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+        bindings[0].descriptorCount = 1;
+        bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        bindings[0].pImmutableSamplers = &m_sampler;
+
+        bindings[1].binding = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        bindings[1].descriptorCount = m_capacity;
+        bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        const VkDescriptorBindingFlags bindingFlags[2] = {
+            0,
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT
+        };
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.bindingCount = 2;
+        bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = &bindingFlagsInfo;
+        layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        layoutInfo.bindingCount = 2;
+        layoutInfo.pBindings = bindings;
+
+        if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create texture table descriptor set layout!");
+        }
+
+        const VkDescriptorPoolSize poolSizes[2] = {
+            {VK_DESCRIPTOR_TYPE_SAMPLER, 1},
+            {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, m_capacity}
+        };
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+        poolInfo.maxSets = 1;
+        poolInfo.poolSizeCount = 2;
+        poolInfo.pPoolSizes = poolSizes;
+
+        if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create texture table descriptor pool!");
+        }
+
+        VkDescriptorSetVariableDescriptorCountAllocateInfo countInfo{};
+        countInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+        countInfo.descriptorSetCount = 1;
+        countInfo.pDescriptorCounts = &m_capacity;
+
+        VkDescriptorSetAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocateInfo.pNext = &countInfo;
+        allocateInfo.descriptorPool = m_descriptorPool;
+        allocateInfo.descriptorSetCount = 1;
+        allocateInfo.pSetLayouts = &m_setLayout;
+
+        if (vkAllocateDescriptorSets(m_device, &allocateInfo, &m_descriptorSet) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate texture table descriptor set!");
+        }
+    }
+
+    void VulkanTextureTable::createWhiteTexture(VulkanUploader& uploader) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        imageInfo.extent = {1, 1, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        m_whiteAllocation = m_allocator->createImage(imageInfo, MemoryUsage::GpuOnly, m_whiteImage);
+
+        VkImageViewCreateInfo viewCreateInfo{};
+        viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewCreateInfo.image = m_whiteImage;
+        viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewCreateInfo.format = imageInfo.format;
+        viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewCreateInfo.subresourceRange.baseMipLevel = 0;
+        viewCreateInfo.subresourceRange.levelCount = 1;
+        viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+        viewCreateInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(m_device, &viewCreateInfo, nullptr, &m_whiteImageView) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create white texture view!");
+        }
+
+        //acquired by the first frame like any other upload
+        constexpr uint32_t white = 0xFFFFFFFF;
+        uploader.uploadImage(m_whiteImage, imageInfo.extent, &white, sizeof(white));
+
+        if (add(m_whiteImageView) != WHITE_TEXTURE) {
+            throw std::runtime_error("White texture must be the first in the texture table!");
+        }
+    }
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "VulkanAllocator.h"
+#include "VulkanUploader.h"
+
+namespace Coreful::renderer::vulkan {
+
+    //every sampled image quads can use in one update-after-bind descriptor array, instances pick theirs by index,
+    //so a frame of mixed images is still one batch behind one pipeline and descriptor set bind
+    class VulkanTextureTable {
+
+    public:
+
+        //retire has to keep its argument alive until every frame submitted so far has finished
+        void init(VkPhysicalDevice physicalDevice, VkDevice device, VulkanAllocator& allocator, VulkanUploader& uploader,
+                  std::function<void(std::function<void()>)> retire);
+        void cleanup();
+
+        //the view has to be in SHADER_READ_ONLY_OPTIMAL by the time a frame samples it, safe from any thread
+        uint32_t add(VkImageView imageView);
+        //the index is handed out again once the frames submitted so far are done with it, the view can go right after those too
+        void remove(uint32_t index);
+
+        void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) const;
+
+        [[nodiscard]] VkDescriptorSetLayout getSetLayout() const {return m_setLayout;}
+        [[nodiscard]] uint32_t getCapacity() const {return m_capacity;}
+
+        //what QuadInstance::textureIndex defaults to, a 1x1 white image so untextured quads keep their color
+        constexpr static uint32_t WHITE_TEXTURE = 0;
+        constexpr static uint32_t MAX_TEXTURES = 16384;//lowered to what the device allows
+
+    private:
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        VulkanAllocator* m_allocator = nullptr;
+        std::function<void(std::function<void()>)> m_retire;
+
+        VkSampler m_sampler = VK_NULL_HANDLE;//immutable, shared by every texture
+        VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+        VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+        VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+        uint32_t m_capacity = 0;
+
+        std::mutex m_mutex;//descriptor updates and the free list
+        std::vector<uint32_t> m_freeIndices;
+        uint32_t m_nextIndex = 0;//never handed out yet from here on
+
+        VkImage m_whiteImage = VK_NULL_HANDLE;
+        Allocation m_whiteAllocation;
+        VkImageView m_whiteImageView = VK_NULL_HANDLE;
+
+        void createSampler();
+        void createDescriptorSet();
+        void createWhiteTexture(VulkanUploader& uploader);
+
+    };
+
+}
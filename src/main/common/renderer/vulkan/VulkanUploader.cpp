@@ -0,0 +1,368 @@
+
+#include "VulkanUploader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+#include "util/Logger.h"
+
+namespace Coreful::renderer::vulkan {
+
+    namespace {
+        //everything that may read an uploaded resource
+        constexpr VkPipelineStageFlags CONSUMER_STAGES = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
+            | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        constexpr VkAccessFlags BUFFER_CONSUMER_ACCESS = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+            | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        constexpr VkAccessFlags IMAGE_CONSUMER_ACCESS = VK_ACCESS_SHADER_READ_BIT;
+
+        VkImageSubresourceRange colorRange() {
+            VkImageSubresourceRange range{};
+            range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            range.baseMipLevel = 0;
+            range.levelCount = 1;
+            range.baseArrayLayer = 0;
+            range.layerCount = 1;
+            return range;
+        }
+    }
+
+    void VulkanUploader::init(VulkanAllocator& allocator, const QueueFamilyIndices& queueFamilyIndices, VkQueue transferQueue, const uint32_t frameCount) {
+        m_allocator = &allocator;
+        m_device = m_allocator->getDevice();
+        m_transferQueue = transferQueue;
+        m_graphicsFamily = queueFamilyIndices.graphicsFamily.value();
+        m_transferFamily = queueFamilyIndices.transferFamily.value_or(m_graphicsFamily);
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(m_allocator->getPhysicalDevice(), &properties);
+        m_copyAlignment = std::max<VkDeviceSize>(m_copyAlignment, properties.limits.optimalBufferCopyOffsetAlignment);
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = m_transferFamily;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;//batches are recycled one by one
+
+        if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload command pool!");
+        }
+
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = STAGING_SIZE;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        m_stagingAllocation = m_allocator->createBuffer(bufferInfo, MemoryUsage::CpuToGpu, m_stagingBuffer);
+
+        m_frames.resize(frameCount);
+
+        LOG_DEBUGF("Uploader Created! ({})", transfersOwnership() ? "dedicated transfer queue" : "graphics queue");
+    }
+
+    void VulkanUploader::cleanup() {
+        //the device is idle, so every batch has finished
+        for (const auto& batch : m_inFlight) vkDestroyFence(m_device, batch.fence, nullptr);
+        for (const auto& batch : m_freeBatches) vkDestroyFence(m_device, batch.fence, nullptr);
+        m_inFlight.clear();
+        m_freeBatches.clear();
+
+        for (const auto semaphore : m_pending.waitSemaphores) vkDestroySemaphore(m_device, semaphore, nullptr);
+        for (const auto& frame : m_frames) {
+            for (const auto semaphore : frame.waitSemaphores) vkDestroySemaphore(m_device, semaphore, nullptr);
+        }
+        for (const auto semaphore : m_freeSemaphores) vkDestroySemaphore(m_device, semaphore, nullptr);
+        m_pending = {};
+        m_frames.clear();
+        m_freeSemaphores.clear();
+
+        vkDestroyCommandPool(m_device, m_commandPool, nullptr);//frees its command buffers too
+        m_allocator->destroyBuffer(m_stagingBuffer, m_stagingAllocation);
+    }
+
+    void VulkanUploader::uploadBuffer(VkBuffer buffer, const VkDeviceSize offset, const void* data, const VkDeviceSize size) {
+        std::lock_guard lock(m_mutex);
+
+        const VkDeviceSize stagingOffset = reserve(size);
+        std::memcpy(static_cast<char*>(m_stagingAllocation.mapped) + stagingOffset, data, size);
+
+        VkBufferCopy region{};
+        region.srcOffset = stagingOffset;
+        region.dstOffset = offset;
+        region.size = size;
+        m_bufferCopies.push_back({buffer, region});
+    }
+
+    void VulkanUploader::uploadImage(VkImage image, const VkExtent3D extent, const void* data, const VkDeviceSize size) {
+        std::lock_guard lock(m_mutex);
+
+        const VkDeviceSize stagingOffset = reserve(size);
+        std::memcpy(static_cast<char*>(m_stagingAllocation.mapped) + stagingOffset, data, size);
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = stagingOffset;
+        region.bufferRowLength = 0;//tightly packed
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = extent;
+        m_imageCopies.push_back({image, region});
+    }
+
+    void VulkanUploader::flush() {
+        std::lock_guard lock(m_mutex);
+        retire(false);
+        submit();
+    }
+
+    void VulkanUploader::beginFrame(const uint32_t frameIndex) {
+        std::lock_guard lock(m_mutex);
+
+        Acquires& frame = m_frames[frameIndex];
+        m_freeSemaphores.insert(m_freeSemaphores.end(), frame.waitSemaphores.begin(), frame.waitSemaphores.end());
+        frame.waitSemaphores.clear();
+        frame.bufferBarriers.clear();
+        frame.imageBarriers.clear();
+    }
+
+    void VulkanUploader::takePending(const uint32_t frameIndex) {
+        std::lock_guard lock(m_mutex);
+
+        Acquires& frame = m_frames[frameIndex];
+        frame.waitSemaphores.insert(frame.waitSemaphores.end(), m_pending.waitSemaphores.begin(), m_pending.waitSemaphores.end());
+        frame.bufferBarriers.insert(frame.bufferBarriers.end(), m_pending.bufferBarriers.begin(), m_pending.bufferBarriers.end());
+        frame.imageBarriers.insert(frame.imageBarriers.end(), m_pending.imageBarriers.begin(), m_pending.imageBarriers.end());
+        m_pending = {};
+    }
+
+    void VulkanUploader::recordAcquireBarriers(VkCommandBuffer commandBuffer, const uint32_t frameIndex) const {
+        const Acquires& frame = m_frames[frameIndex];
+        if (frame.bufferBarriers.empty() && frame.imageBarriers.empty()) return;
+
+        vkCmdPipelineBarrier(commandBuffer, WAIT_STAGE, CONSUMER_STAGES, 0,
+            0, nullptr,
+            static_cast<uint32_t>(frame.bufferBarriers.size()), frame.bufferBarriers.data(),
+            static_cast<uint32_t>(frame.imageBarriers.size()), frame.imageBarriers.data());
+    }
+
+    VkDeviceSize VulkanUploader::reserve(const VkDeviceSize size) {
+        if (size > STAGING_SIZE) {
+            throw std::runtime_error("Upload is larger than the staging ring!");
+        }
+
+        for (;;) {
+            if (m_used == 0) m_head = 0;//ring is empty, start over at the front
+
+            VkDeviceSize offset = (m_head + m_copyAlignment - 1) / m_copyAlignment * m_copyAlignment;
+            VkDeviceSize needed = offset - m_head + size;
+
+            //doesn't fit before the end, the tail of the ring is skipped
+            if (offset + size > STAGING_SIZE) {
+                offset = 0;
+                needed = STAGING_SIZE - m_head + size;
+            }
+
+            if (m_used + needed <= STAGING_SIZE) {
+                m_head = offset + size;
+                m_used += needed;
+                m_batchBytes += needed;
+                return offset;
+            }
+
+            //ring is full, the batch being built may be what fills it
+            if (m_inFlight.empty()) submit();
+            retire(true);
+        }
+    }
+
+    void VulkanUploader::submit() {
+        if (m_bufferCopies.empty() && m_imageCopies.empty()) return;
+
+        const Batch batch = acquireBatch();
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+
+        //images have to be in TRANSFER_DST before the copies
+        std::vector<VkImageMemoryBarrier> imageBarriers(m_imageCopies.size());
+        for (size_t i = 0; i < m_imageCopies.size(); i++) {
+            VkImageMemoryBarrier& barrier = imageBarriers[i];
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = m_imageCopies[i].image;
+            barrier.subresourceRange = colorRange();
+        }
+        if (!imageBarriers.empty()) {
+            vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                0, nullptr, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+        }
+
+        //one vkCmdCopyBuffer per destination buffer
+        std::stable_sort(m_bufferCopies.begin(), m_bufferCopies.end(), [](const BufferCopy& a, const BufferCopy& b) {
+            return std::less<VkBuffer>{}(a.buffer, b.buffer);
+        });
+
+        std::vector<VkBuffer> buffers;
+        std::vector<VkBufferCopy> regions;
+        for (size_t i = 0; i < m_bufferCopies.size(); i++) {
+            regions.push_back(m_bufferCopies[i].region);
+
+            if (i + 1 == m_bufferCopies.size() || m_bufferCopies[i + 1].buffer != m_bufferCopies[i].buffer) {
+                vkCmdCopyBuffer(batch.commandBuffer, m_stagingBuffer, m_bufferCopies[i].buffer,
+                    static_cast<uint32_t>(regions.size()), regions.data());
+                buffers.push_back(m_bufferCopies[i].buffer);
+                regions.clear();
+            }
+        }
+
+        for (const auto& copy : m_imageCopies) {
+            vkCmdCopyBufferToImage(batch.commandBuffer, m_stagingBuffer, copy.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy.region);
+        }
+
+        //with a separate transfer family the release happens here and the matching acquire on the graphics queue,
+        //otherwise a plain barrier makes the writes visible
+        const bool transfer = transfersOwnership();
+
+        std::vector<VkBufferMemoryBarrier> bufferBarriers(buffers.size());
+        for (size_t i = 0; i < buffers.size(); i++) {
+            VkBufferMemoryBarrier& barrier = bufferBarriers[i];
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = transfer ? 0 : BUFFER_CONSUMER_ACCESS;
+            barrier.srcQueueFamilyIndex = transfer ? m_transferFamily : VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = transfer ? m_graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = buffers[i];
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+        }
+
+        for (auto& barrier : imageBarriers) {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = transfer ? 0 : IMAGE_CONSUMER_ACCESS;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcQueueFamilyIndex = transfer ? m_transferFamily : VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = transfer ? m_graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+        }
+
+        const VkPipelineStageFlags dstStage = transfer ? static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT) : CONSUMER_STAGES;
+        vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0,
+            0, nullptr,
+            static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+            static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+
+        if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to record upload command buffer!");
+        }
+
+        VkSemaphore semaphore = acquireSemaphore();
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &batch.commandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &semaphore;
+
+        if (vkQueueSubmit(m_transferQueue, 1, &submitInfo, batch.fence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to submit upload command buffer!");
+        }
+
+        //acquires mirror the releases, only the access masks differ
+        m_pending.waitSemaphores.push_back(semaphore);
+        if (transfer) {
+            for (auto& barrier : bufferBarriers) {
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = BUFFER_CONSUMER_ACCESS;
+                m_pending.bufferBarriers.push_back(barrier);
+            }
+            for (auto& barrier : imageBarriers) {
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = IMAGE_CONSUMER_ACCESS;
+                m_pending.imageBarriers.push_back(barrier);
+            }
+        }
+
+        m_inFlight.push_back({batch.commandBuffer, batch.fence, m_batchBytes});
+        m_batchBytes = 0;
+        m_bufferCopies.clear();
+        m_imageCopies.clear();
+    }
+
+    void VulkanUploader::retire(bool wait) {
+        //batches finish in submission order, so the ring frees up from the tail
+        while (!m_inFlight.empty()) {
+            const Batch& batch = m_inFlight.front();
+
+            if (wait) {
+                vkWaitForFences(m_device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+                wait = false;
+            } else if (vkGetFenceStatus(m_device, batch.fence) != VK_SUCCESS) {
+                break;
+            }
+
+            m_used -= batch.bytes;
+            m_freeBatches.push_back(batch);
+            m_inFlight.pop_front();
+        }
+    }
+
+    VulkanUploader::Batch VulkanUploader::acquireBatch() {
+        if (!m_freeBatches.empty()) {
+            Batch batch = m_freeBatches.back();
+            m_freeBatches.pop_back();
+            vkResetFences(m_device, 1, &batch.fence);
+            return batch;
+        }
+
+        Batch batch;
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = m_commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(m_device, &allocInfo, &batch.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate upload command buffer!");
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if (vkCreateFence(m_device, &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload fence!");
+        }
+        return batch;
+    }
+
+    VkSemaphore VulkanUploader::acquireSemaphore() {
+        if (!m_freeSemaphores.empty()) {
+            VkSemaphore semaphore = m_freeSemaphores.back();
+            m_freeSemaphores.pop_back();
+            return semaphore;
+        }
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        VkSemaphore semaphore;
+        if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload semaphore!");
+        }
+        return semaphore;
+    }
+
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "VulkanAllocator.h"
+#include "VulkanQueues.h"
+
+namespace Coreful::renderer::vulkan {
+
+    //copies data into gpu-only resources through a staging ring, on the transfer queue when the device has one
+    class VulkanUploader {
+
+    public:
+
+        void init(VulkanAllocator& allocator, const QueueFamilyIndices& queueFamilyIndices, VkQueue transferQueue, uint32_t frameCount);
+        void cleanup();
+
+        //data is copied into the staging ring right away, the copy itself is batched until flush()
+        void uploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size);
+        //whole mip 0 of a color image, which ends up in SHADER_READ_ONLY_OPTIMAL
+        void uploadImage(VkImage image, VkExtent3D extent, const void* data, VkDeviceSize size);
+
+        //submits every batched copy in one command buffer, called from the render thread
+        void flush();
+
+        //the frame's fence has signaled, semaphores it waited on can be reused
+        void beginFrame(uint32_t frameIndex);
+        //hands all flushed uploads to the frame that is about to be recorded
+        void takePending(uint32_t frameIndex);
+
+        //queue family ownership acquires, recorded outside the render pass
+        void recordAcquireBarriers(VkCommandBuffer commandBuffer, uint32_t frameIndex) const;
+        [[nodiscard]] const std::vector<VkSemaphore>& getWaitSemaphores(uint32_t frameIndex) const {return m_frames[frameIndex].waitSemaphores;}
+
+        //stage the graphics submit has to wait at, acquire barriers start from it
+        constexpr static VkPipelineStageFlags WAIT_STAGE = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        constexpr static VkDeviceSize STAGING_SIZE = VkDeviceSize{16} * 1024 * 1024;
+
+    private:
+
+        struct BufferCopy {
+            VkBuffer buffer;
+            VkBufferCopy region;
+        };
+
+        struct ImageCopy {
+            VkImage image;
+            VkBufferImageCopy region;
+        };
+
+        //barriers and semaphores the graphics queue has to consume
+        struct Acquires {
+            std::vector<VkSemaphore> waitSemaphores;
+            std::vector<VkBufferMemoryBarrier> bufferBarriers;
+            std::vector<VkImageMemoryBarrier> imageBarriers;
+        };
+
+        struct Batch {
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            VkFence fence = VK_NULL_HANDLE;
+            VkDeviceSize bytes = 0;//staging bytes held until the fence signals
+        };
+
+        VulkanAllocator* m_allocator = nullptr;
+        VkDevice m_device = VK_NULL_HANDLE;
+        VkQueue m_transferQueue = VK_NULL_HANDLE;
+        uint32_t m_transferFamily = 0;
+        uint32_t m_graphicsFamily = 0;
+        VkDeviceSize m_copyAlignment = 16;
+
+        VkCommandPool m_commandPool = VK_NULL_HANDLE;
+
+        VkBuffer m_stagingBuffer = VK_NULL_HANDLE;
+        Allocation m_stagingAllocation;
+        VkDeviceSize m_head = 0;//next write offset
+        VkDeviceSize m_used = 0;//bytes between the oldest in-flight batch and m_head, including wrap padding
+
+        std::vector<BufferCopy> m_bufferCopies;
+        std::vector<ImageCopy> m_imageCopies;
+        VkDeviceSize m_batchBytes = 0;
+
+        std::deque<Batch> m_inFlight;
+        std::vector<Batch> m_freeBatches;
+        std::vector<VkSemaphore> m_freeSemaphores;
+
+        Acquires m_pending;
+        std::vector<Acquires> m_frames;
+
+        std::mutex m_mutex;
+
+        VkDeviceSize reserve(VkDeviceSize size);
+        void submit();
+        void retire(bool wait);
+        Batch acquireBatch();
+        VkSemaphore acquireSemaphore();
+
+        [[nodiscard]] bool transfersOwnership() const {return m_transferFamily != m_graphicsFamily;}
+
+    };
+
+}
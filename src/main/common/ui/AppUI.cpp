@@ -12,7 +12,7 @@ namespace Coreful::ui {
 
         m_topBar->setColor(util::Color(0x333));
 
-        const float x = (static_cast<float>(m_window->getWidth()) - 40) / static_cast<float>(m_window->getWidth());
+        const float x = static_cast<float>(m_window->getWidth()) - 40;
 
         m_exitButton = std::make_unique<RectanglePrimitive>(math::Vector2f(x, 0), 40, 40);
 
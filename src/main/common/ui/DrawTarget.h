@@ -1,5 +1,8 @@
 #pragma once
 
+#include "renderer/DamageRegion.h"
+#include "renderer/QuadInstance.h"
+
 namespace Coreful::ui {
     class Drawable;
 
@@ -14,5 +17,11 @@ namespace Coreful::ui {
         int m_width = 0, m_height = 0;
 
         virtual void draw(Drawable& drawable) const = 0;
+
+        //appends one quad to the current frame's batch
+        virtual void drawQuad(const QuadInstance& quad) const = 0;
+
+        //marks part of the target as changed since the last frame, unchanged frames may not be redrawn at all
+        virtual void addDamage(const DamageRect& rect) const = 0;
     };
 }
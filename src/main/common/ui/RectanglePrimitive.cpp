@@ -11,14 +11,44 @@ namespace Coreful::ui {
     m_position(position), m_width(width), m_height(height) {}
 
     void RectanglePrimitive::setColor(const util::Color& color) {
+        if (color.rF() == m_r && color.gF() == m_g && color.bF() == m_b && color.aF() == m_a) return;
+
         m_r = color.rF();
         m_g = color.gF();
         m_b = color.bF();
         m_a = color.aF();
+        m_dirty = true;
+    }
+
+    void RectanglePrimitive::setPosition(const math::Vector2f position) {
+        if (position.x == m_position.x && position.y == m_position.y) return;
+
+        m_position = position;
+        m_dirty = true;
+    }
+
+    void RectanglePrimitive::setSize(const float width, const float height) {
+        if (width == m_width && height == m_height) return;
+
+        m_width = width;
+        m_height = height;
+        m_dirty = true;
     }
 
     void RectanglePrimitive::draw(const DrawTarget& target) const {
+        if (m_dirty) {
+            //the old bounds have to be repainted with whatever is underneath
+            if (m_drawnBounds) target.addDamage(*m_drawnBounds);
+            m_drawnBounds = getBounds();
+            target.addDamage(*m_drawnBounds);
+            m_dirty = false;
+        }
+
+        target.drawQuad({m_position.x, m_position.y, m_width, m_height, m_r, m_g, m_b, m_a});
+    }
 
+    DamageRect RectanglePrimitive::getBounds() const {
+        return DamageRect::fromBounds(m_position.x, m_position.y, m_width, m_height);
     }
 
 }
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <optional>
+
 #include "Drawable.h"
 #include "math/Vector2.h"
+#include "renderer/DamageRegion.h"
 #include "util/Color.h"
 
 namespace Coreful::ui {
@@ -12,7 +15,10 @@ namespace Coreful::ui {
         RectanglePrimitive(math::Vector2f position, float width, float height);
 
         void setColor(const util::Color& color);
+        void setPosition(math::Vector2f position);
+        void setSize(float width, float height);
 
+        //reports where it was and where it is now to target when something changed since the last draw
         void draw(const DrawTarget& target) const override;
 
     private:
@@ -21,6 +27,11 @@ namespace Coreful::ui {
         float m_width, m_height;
         float m_r = 1.0f, m_g = 1.0f, m_b = 1.0f, m_a = 1.0f;
 
+        mutable bool m_dirty = true;
+        mutable std::optional<DamageRect> m_drawnBounds;//nothing drawn yet
+
+        [[nodiscard]] DamageRect getBounds() const;
+
     };
 }
 
@@ -0,0 +1,236 @@
+
+#include "BinaryLog.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Coreful::BinaryLog {
+
+    namespace {
+
+        struct Site {
+            Logger::LogType type;
+            std::string format;
+            std::string file;
+            uint32_t line;
+            std::vector<ArgType> args;
+        };
+
+        constexpr size_t RECORD_ALIGNMENT = 8;//keeps every RecordHeader aligned for the atomic publish
+
+        struct State {
+            std::mutex mutex;//registration, init and shutdown, never taken by write()
+            std::vector<Site> sites;
+
+            uint8_t* base = nullptr;
+            size_t capacity = 0;
+            std::atomic<size_t> cursor{0};
+            std::atomic<size_t> dropped{0};
+            std::atomic<bool> open{false};
+
+#ifdef _WIN32
+            HANDLE file = INVALID_HANDLE_VALUE;
+            HANDLE mapping = nullptr;
+#else
+            int file = -1;
+#endif
+        };
+
+        State& getState() {
+            static State state;
+            return state;
+        }
+
+        //reserve() without the open check, for init() writing sites before anyone else may reserve
+        uint8_t* reserveRecord(State& state, size_t& size) {
+            size = (size + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+            if (size > UINT16_MAX) {
+                //RecordHeader::size can't hold it, lost just like a record that doesn't fit anymore
+                state.dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            const size_t offset = state.cursor.fetch_add(size, std::memory_order_relaxed);
+            if (offset + size > state.capacity) {
+                state.dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            return state.base + offset;
+        }
+
+        void writeSite(State& state, const uint32_t id, const Site& site) {
+            const auto format = static_cast<uint16_t>(std::min<size_t>(site.format.size(), UINT16_MAX));
+            const auto file = static_cast<uint16_t>(std::min<size_t>(site.file.size(), UINT16_MAX));
+            size_t size = RECORD_HEADER_SIZE + sizeof(uint32_t) + 2 * sizeof(uint8_t) + sizeof(uint32_t) + site.args.size()
+                        + sizeof(uint16_t) + format + sizeof(uint16_t) + file;
+
+            uint8_t* record = reserveRecord(state, size);
+            if (!record) return;
+
+            uint8_t* out = put(record + RECORD_HEADER_SIZE, id);
+            out = put(out, static_cast<uint8_t>(site.type));
+            out = put(out, static_cast<uint8_t>(site.args.size()));
+            out = put(out, site.line);
+            for (const ArgType arg : site.args) out = put(out, arg);
+            out = put(out, format);
+            std::memcpy(out, site.format.data(), format);
+            out = put(out + format, file);
+            std::memcpy(out, site.file.data(), file);
+
+            commit(record, RecordKind::Site, size);
+        }
+
+        void unmap(State& state) {
+#ifdef _WIN32
+            if (state.base) UnmapViewOfFile(state.base);
+            if (state.mapping) CloseHandle(state.mapping);
+            state.mapping = nullptr;
+#else
+            if (state.base) munmap(state.base, state.capacity);
+#endif
+            state.base = nullptr;
+        }
+
+        void closeFile(State& state, const size_t size) {
+#ifdef _WIN32
+            if (state.file == INVALID_HANDLE_VALUE) return;
+            LARGE_INTEGER end;
+            end.QuadPart = static_cast<LONGLONG>(size);
+            SetFilePointerEx(state.file, end, nullptr, FILE_BEGIN);
+            SetEndOfFile(state.file);
+            CloseHandle(state.file);
+            state.file = INVALID_HANDLE_VALUE;
+#else
+            if (state.file < 0) return;
+            if (ftruncate(state.file, static_cast<off_t>(size)) != 0) {
+                log(Logger::LogType::Warn, "Failed to trim binary log");
+            }
+            close(state.file);
+            state.file = -1;
+#endif
+        }
+
+        bool map(State& state, const std::string& path) {
+#ifdef _WIN32
+            state.file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                                     FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (state.file == INVALID_HANDLE_VALUE) return false;
+
+            const auto capacity = static_cast<uint64_t>(state.capacity);
+            state.mapping = CreateFileMappingA(state.file, nullptr, PAGE_READWRITE, static_cast<DWORD>(capacity >> 32),
+                                               static_cast<DWORD>(capacity), nullptr);
+            if (!state.mapping) return false;
+
+            state.base = static_cast<uint8_t*>(MapViewOfFile(state.mapping, FILE_MAP_WRITE, 0, 0, state.capacity));
+            return state.base != nullptr;
+#else
+            state.file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (state.file < 0) return false;
+
+            //the new pages read as zero, which the decoder takes as the end of the records
+            if (ftruncate(state.file, static_cast<off_t>(state.capacity)) != 0) return false;
+
+            void* base = mmap(nullptr, state.capacity, PROT_READ | PROT_WRITE, MAP_SHARED, state.file, 0);
+            if (base == MAP_FAILED) return false;
+
+            state.base = static_cast<uint8_t*>(base);
+            return true;
+#endif
+        }
+    }
+
+    bool init(const std::string& path, const size_t capacity) {
+        State& state = getState();
+        std::lock_guard lock(state.mutex);
+        if (state.open.load(std::memory_order_relaxed)) return true;
+
+        state.capacity = std::max(capacity, sizeof(FileHeader) + RECORD_ALIGNMENT);
+        if (!map(state, path)) {
+            log(Logger::LogType::Error, "Failed to map binary log ", path);
+            unmap(state);
+            closeFile(state, 0);
+            return false;
+        }
+
+        FileHeader header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.startNs = now();
+        std::memcpy(state.base, &header, sizeof(header));
+
+        state.cursor.store(sizeof(FileHeader), std::memory_order_relaxed);
+        state.dropped.store(0, std::memory_order_relaxed);
+        //sites hit before the file existed, written before it opens so no event can get ahead of its site
+        for (size_t i = 0; i < state.sites.size(); i++) writeSite(state, static_cast<uint32_t>(i), state.sites[i]);
+
+        state.open.store(true, std::memory_order_release);
+
+        LOG_INFO("Binary log opened: ", path);
+        return true;
+    }
+
+    void shutdown() {
+        State& state = getState();
+        std::lock_guard lock(state.mutex);
+        if (!state.open.exchange(false, std::memory_order_acq_rel)) return;
+
+        const size_t end = std::min(state.cursor.load(std::memory_order_relaxed), state.capacity);
+
+        //a clean close records the size, the decoder then ignores the zeroed tail
+        const uint64_t used = end - sizeof(FileHeader);
+        std::memcpy(state.base + offsetof(FileHeader, used), &used, sizeof(used));
+
+#ifdef _WIN32
+        FlushViewOfFile(state.base, end);
+#else
+        msync(state.base, end, MS_SYNC);
+#endif
+        unmap(state);
+        closeFile(state, end);
+
+        if (const size_t dropped = state.dropped.load(std::memory_order_relaxed)) {
+            log(Logger::LogType::Warn, "Binary log dropped ", dropped, " records, it was full or they were too large");
+        }
+    }
+
+    bool isOpen() {
+        return getState().open.load(std::memory_order_acquire);
+    }
+
+    uint32_t registerSite(const Logger::LogType type, const std::string_view format, const std::string_view file,
+                          const uint32_t line, const ArgType* args, const size_t argCount) {
+        State& state = getState();
+        std::lock_guard lock(state.mutex);
+
+        const auto id = static_cast<uint32_t>(state.sites.size());
+        state.sites.push_back({type, std::string(format), std::string(file), line, {args, args + argCount}});
+
+        if (state.open.load(std::memory_order_relaxed)) writeSite(state, id, state.sites.back());
+        return id;
+    }
+
+    uint8_t* reserve(size_t& size) {
+        State& state = getState();
+        if (!state.open.load(std::memory_order_acquire)) return nullptr;
+        return reserveRecord(state, size);
+    }
+
+    void commit(uint8_t* record, const RecordKind kind, const size_t size) {
+        //kind and size go in with one store, after the payload
+        const RecordHeader header{static_cast<uint16_t>(kind), static_cast<uint16_t>(size)};
+        uint32_t word;
+        std::memcpy(&word, &header, sizeof(word));
+        std::atomic_ref(*reinterpret_cast<uint32_t*>(record)).store(word, std::memory_order_release);
+    }
+
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+//With COREFUL_BINARY_LOG the LOG_*F macros write a site id, a timestamp and the raw arguments
+//into a memory mapped file instead of formatting, tools/LogDecoder turns it back into text.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "BinaryLogFormat.h"
+#include "Logger.h"
+
+namespace Coreful::BinaryLog {
+
+    constexpr size_t DEFAULT_CAPACITY = 64 * 1024 * 1024;
+
+    //maps a file of capacity bytes and writes every site registered so far, events past the end are dropped
+    bool init(const std::string& path, size_t capacity = DEFAULT_CAPACITY);
+
+    //cuts the file to what was written and unmaps it, nothing may log into it concurrently
+    void shutdown();
+
+    bool isOpen();
+
+    //format and types are fixed per call site, they are stored once and events only refer to the id
+    uint32_t registerSite(Logger::LogType type, std::string_view format, std::string_view file, uint32_t line,
+                          const ArgType* args, size_t argCount);
+
+    //size bytes of the mapping for one record, nullptr when closed or full
+    uint8_t* reserve(size_t& size);
+    //publishes a reserved record, the decoder stops at the first one never committed
+    void commit(uint8_t* record, RecordKind kind, size_t size);
+
+    inline uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    template <typename T>
+    constexpr ArgType argType() {
+        if constexpr (std::is_same_v<T, bool>) return ArgType::Boolean;
+        else if constexpr (std::is_floating_point_v<T>) return ArgType::Floating;
+        else if constexpr (std::is_integral_v<T>) return std::is_signed_v<T> ? ArgType::Signed : ArgType::Unsigned;
+        else {
+            static_assert(std::is_convertible_v<const T&, std::string_view>, "Type can't be stored in the binary log");
+            return ArgType::String;
+        }
+    }
+
+    template <typename... Args>
+    struct Signature {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "Too many arguments for one binary log call");
+
+        static constexpr ArgType TYPES[sizeof...(Args) + 1] = {argType<Args>()..., ArgType{}};
+        static constexpr size_t COUNT = sizeof...(Args);
+    };
+
+    //only used in decltype, turns the arguments of a call site into its Signature
+    template <typename... Args>
+    Signature<std::decay_t<Args>...> signatureOf(const Args&...);
+
+    template <typename T>
+    size_t encodedSize(const T& value) {
+        if constexpr (argType<T>() == ArgType::String) {
+            return sizeof(uint16_t) + std::min(std::string_view(value).size(), MAX_STRING_SIZE);
+        } else if constexpr (argType<T>() == ArgType::Boolean) {
+            return sizeof(uint8_t);
+        } else {
+            return sizeof(uint64_t);
+        }
+    }
+
+    template <typename T>
+    uint8_t* encode(uint8_t* out, const T& value) {
+        constexpr ArgType type = argType<T>();
+
+        if constexpr (type == ArgType::String) {
+            const std::string_view text(value);
+            const auto size = static_cast<uint16_t>(std::min(text.size(), MAX_STRING_SIZE));
+            out = put(out, size);
+            std::memcpy(out, text.data(), size);
+            return out + size;
+        } else if constexpr (type == ArgType::Boolean) {
+            return put(out, static_cast<uint8_t>(value));
+        } else if constexpr (type == ArgType::Floating) {
+            return put(out, static_cast<double>(value));
+        } else if constexpr (type == ArgType::Signed) {
+            return put(out, static_cast<int64_t>(value));
+        } else {
+            return put(out, static_cast<uint64_t>(value));
+        }
+    }
+
+    template <typename... Args>
+    void write(const uint32_t site, const Args&... args) {
+        size_t size = RECORD_HEADER_SIZE + sizeof(uint32_t) + sizeof(uint64_t) + (size_t{0} + ... + encodedSize(args));
+
+        uint8_t* record = reserve(size);
+        if (!record) return;
+
+        uint8_t* out = put(record + RECORD_HEADER_SIZE, site);
+        out = put(out, now());
+        ((out = encode(out, args)), ...);
+
+        commit(record, RecordKind::Event, size);
+    }
+}
+
+//registers the site on its first run, falls back to text logging while no binary log is open
+#define COREFUL_BINARY_LOG_AT(type, fmt, ...) \
+    do { if constexpr (::Coreful::Logger::isEnabled(type)) { \
+        using CorefulLogSignature = decltype(::Coreful::BinaryLog::signatureOf(__VA_ARGS__)); \
+        static const uint32_t corefulLogSite = ::Coreful::BinaryLog::registerSite(type, fmt, __FILE__, __LINE__, \
+            CorefulLogSignature::TYPES, CorefulLogSignature::COUNT); \
+        if (::Coreful::BinaryLog::isOpen()) ::Coreful::BinaryLog::write(corefulLogSite __VA_OPT__(,) __VA_ARGS__); \
+        else ::Coreful::Logger::logf(type, fmt __VA_OPT__(,) __VA_ARGS__); \
+    } } while (0)
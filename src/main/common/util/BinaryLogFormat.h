@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+//on-disk layout of the binary log, shared by the writer and tools/LogDecoder
+//all values are little endian and unaligned, read them with memcpy
+namespace Coreful::BinaryLog {
+
+    constexpr char MAGIC[8] = {'C', 'O', 'R', 'E', 'B', 'L', 'O', 'G'};
+    constexpr uint32_t VERSION = 1;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t startNs;//steady clock ns when the file was opened, subtract it from event timestamps for the time since
+        uint64_t used;//bytes of records after the header, 0 if the process never closed the file
+    };
+
+    static_assert(sizeof(FileHeader) == 32, "FileHeader layout changed");
+
+    //a kind of 0 ends the records, the rest of the file is still zeroed
+    enum class RecordKind : uint16_t {End = 0, Site = 1, Event = 2};
+
+    //every record starts with this, size includes it
+    struct RecordHeader {
+        uint16_t kind;
+        uint16_t size;
+    };
+
+    constexpr size_t RECORD_HEADER_SIZE = sizeof(RecordHeader);
+
+    //how one argument is stored in an event, decided by its c++ type at the call site
+    enum class ArgType : uint8_t {
+        Signed = 1,//int64
+        Unsigned = 2,//uint64
+        Floating = 3,//double
+        Boolean = 4,//uint8
+        String = 5//uint16 length, then the bytes
+    };
+
+    constexpr size_t MAX_ARGS = 16;
+    constexpr size_t MAX_STRING_SIZE = 1024;//longer string arguments are cut
+
+    //Site:  uint32 id, uint8 log type, uint8 arg count, uint32 line, arg types[count],
+    //       uint16 format size, format, uint16 file size, file
+    //Event: uint32 site id, uint64 steady clock ns (the same clock as FileHeader::startNs, not relative to it), encoded args
+
+    template <typename T>
+    uint8_t* put(uint8_t* out, const T& value) {
+        std::memcpy(out, &value, sizeof(T));
+        return out + sizeof(T);
+    }
+
+    template <typename T>
+    const uint8_t* get(const uint8_t* in, T& value) {
+        std::memcpy(&value, in, sizeof(T));
+        return in + sizeof(T);
+    }
+}
@@ -0,0 +1,269 @@
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Coreful::Logger {
+
+    namespace {
+
+        struct alignas(64) Slot {
+            std::atomic<size_t> sequence;
+            LogType type;
+            uint16_t length;
+            char text[MESSAGE_SIZE];
+        };
+
+        static_assert(sizeof(Slot) == SLOT_SIZE, "Log slots must stay one fixed size");
+        static_assert((RING_CAPACITY & (RING_CAPACITY - 1)) == 0, "RING_CAPACITY must be a power of two");
+
+        //bounded multi-producer ring (Vyukov) drained by one writer thread
+        class Backend {
+
+        public:
+
+            Backend() {
+                for (size_t i = 0; i < RING_CAPACITY; i++) m_slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+
+            ~Backend() {stop();}//drains whatever is still queued at exit
+
+            void start() {
+                std::lock_guard lock(m_controlMutex);
+                if (m_running.load(std::memory_order_relaxed)) return;
+
+                m_file.open("log.txt", std::ios::trunc);
+                m_stopping.store(false, std::memory_order_relaxed);
+                m_running.store(true, std::memory_order_release);
+                m_thread = std::thread(&Backend::run, this);
+            }
+
+            void stop() {
+                std::lock_guard lock(m_controlMutex);
+                if (!m_running.load(std::memory_order_relaxed)) return;
+
+                m_running.store(false, std::memory_order_release);
+                m_stopping.store(true, std::memory_order_release);
+                wake();
+                m_thread.join();
+
+                //anything pushed while the thread was finishing, pairs with the fence in tryPush:
+                //a message this drain misses was pushed by a producer that sees m_running false and flushes it itself
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                std::string batch;
+                drain(batch);
+                write(batch);
+            }
+
+            void push(const LogType type, const std::string_view message) {
+                if (!m_running.load(std::memory_order_acquire)) {
+                    if (m_stopping.load(std::memory_order_acquire)) {
+                        writeDirect(type, message);//after shutdown
+                        return;
+                    }
+                    start();
+                }
+
+                while (!tryPush(type, message)) {
+                    if (m_policy.load(std::memory_order_relaxed) == OverflowPolicy::Drop) {
+                        m_dropped.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+
+                    //block until the writer has freed some slots
+                    const uint32_t freed = m_freed.load(std::memory_order_acquire);
+                    if (tryPush(type, message)) break;
+                    if (!m_running.load(std::memory_order_acquire)) {
+                        writeDirect(type, message);
+                        return;
+                    }
+                    wake();
+                    m_freed.wait(freed, std::memory_order_acquire);
+                }
+
+                //stop() may have drained for the last time before this message landed, nobody else would write it
+                if (!m_running.load(std::memory_order_acquire)) flushStopped();
+            }
+
+            void setPolicy(const OverflowPolicy policy) {m_policy.store(policy, std::memory_order_relaxed);}
+
+        private:
+
+            Slot m_slots[RING_CAPACITY];
+            alignas(64) std::atomic<size_t> m_enqueuePos{0};
+            alignas(64) size_t m_dequeuePos = 0;//writer thread only
+
+            alignas(64) std::atomic<uint32_t> m_wake{0};
+            std::atomic<bool> m_waiting{false};
+            std::atomic<uint32_t> m_freed{0};
+            std::atomic<size_t> m_dropped{0};
+            std::atomic<OverflowPolicy> m_policy{OverflowPolicy::Drop};
+
+            std::atomic<bool> m_running{false};
+            std::atomic<bool> m_stopping{false};
+            std::mutex m_controlMutex;
+            std::mutex m_directMutex;
+            std::thread m_thread;
+            std::ofstream m_file;
+
+            bool tryPush(const LogType type, const std::string_view message) {
+                size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+                Slot* slot;
+
+                for (;;) {
+                    slot = &m_slots[pos & (RING_CAPACITY - 1)];
+                    const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+                    const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+                    if (diff == 0) {
+                        if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+                    } else if (diff < 0) {
+                        return false;//full
+                    } else {
+                        pos = m_enqueuePos.load(std::memory_order_relaxed);
+                    }
+                }
+
+                const size_t length = std::min(message.size(), MESSAGE_SIZE);
+                slot->type = type;
+                slot->length = static_cast<uint16_t>(length);
+                std::memcpy(slot->text, message.data(), length);
+                slot->sequence.store(pos + 1, std::memory_order_release);
+
+                //only pay for a wake up when the writer is actually asleep, also orders the slot before push() checks m_running
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (m_waiting.load(std::memory_order_relaxed)) wake();
+                return true;
+            }
+
+            [[nodiscard]] bool hasMessage() const {
+                const Slot& slot = m_slots[m_dequeuePos & (RING_CAPACITY - 1)];
+                return slot.sequence.load(std::memory_order_acquire) == m_dequeuePos + 1;
+            }
+
+            void drain(std::string& batch) {
+                while (hasMessage()) {
+                    Slot& slot = m_slots[m_dequeuePos & (RING_CAPACITY - 1)];
+
+                    batch += logTypeToString(slot.type);
+                    batch.append(slot.text, slot.length);
+                    batch += '\n';
+
+                    slot.sequence.store(m_dequeuePos + RING_CAPACITY, std::memory_order_release);
+                    m_dequeuePos++;
+                }
+
+                if (const size_t dropped = m_dropped.exchange(0, std::memory_order_relaxed)) {
+                    batch += logTypeToString(LogType::Warn);
+                    batch += std::to_string(dropped) + " log messages dropped, ring was full\n";
+                }
+            }
+
+            void write(const std::string& batch) {
+                if (batch.empty()) return;
+
+                std::lock_guard lock(m_directMutex);
+                std::fwrite(batch.data(), 1, batch.size(), stdout);
+                std::fflush(stdout);
+                m_file.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+                m_file.flush();
+            }
+
+            void flushStopped() {
+                //stop() drains under the same lock, so this is the only consumer now
+                std::lock_guard lock(m_controlMutex);
+                if (m_running.load(std::memory_order_relaxed)) return;//started again, its writer thread picks the message up
+
+                std::string batch;
+                drain(batch);
+                write(batch);
+            }
+
+            void writeDirect(const LogType type, const std::string_view message) {
+                std::string line = logTypeToString(type);
+                line.append(message);
+                line += '\n';
+
+                std::lock_guard lock(m_directMutex);
+                std::fwrite(line.data(), 1, line.size(), stdout);
+                std::fflush(stdout);
+                if (!m_file.is_open()) m_file.open("log.txt", std::ios::app);
+                m_file << line;
+                m_file.flush();
+            }
+
+            void wake() {
+                m_wake.fetch_add(1, std::memory_order_release);
+                m_wake.notify_one();
+            }
+
+            void run() {
+                std::string batch;
+                batch.reserve(RING_CAPACITY * 64);
+
+                for (;;) {
+                    drain(batch);
+
+                    if (!batch.empty()) {
+                        write(batch);//one flush per batch instead of one per message
+                        batch.clear();
+
+                        m_freed.fetch_add(1, std::memory_order_release);
+                        m_freed.notify_all();
+                        continue;
+                    }
+
+                    if (m_stopping.load(std::memory_order_acquire)) break;
+
+                    const uint32_t wake = m_wake.load(std::memory_order_acquire);
+                    m_waiting.store(true, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                    if (!hasMessage() && !m_stopping.load(std::memory_order_acquire)) m_wake.wait(wake, std::memory_order_acquire);
+                    m_waiting.store(false, std::memory_order_relaxed);
+                }
+
+                //blocked producers fall back to writing directly
+                m_freed.fetch_add(1, std::memory_order_release);
+                m_freed.notify_all();
+            }
+
+        };
+
+        Backend& getBackend() {
+            static Backend backend;
+            return backend;
+        }
+    }
+
+    void init() {
+        getBackend().start();
+#ifdef COREFUL_BINARY_LOG
+        BinaryLog::init("log.bin");
+#endif
+    }
+
+    void shutdown() {
+#ifdef COREFUL_BINARY_LOG
+        BinaryLog::shutdown();
+#endif
+        getBackend().stop();
+    }
+
+    void setOverflowPolicy(const OverflowPolicy policy) {
+        getBackend().setPolicy(policy);
+    }
+
+    void enqueue(const LogType type, const std::string_view message) {
+        getBackend().push(type, message);
+    }
+
+}
@@ -1,10 +1,31 @@
 #pragma once
 
-#include <fstream>
-#include <iostream>
-#include <sstream>
-#include <string>
-
+#include <version>
+
+//GCC 13, Clang 17 with libc++ and MSVC 19.29 are the first to ship it, CMake checks this too
+#ifndef __cpp_lib_format
+#error "Coreful's logger needs std::format (<format>)"
+#endif
+
+#include <cstddef>
+#include <format>
+#include <ostream>
+#include <streambuf>
+#include <string_view>
+
+//messages below COREFUL_LOG_LEVEL are compiled out, the LOG_* macros don't even evaluate their arguments
+#define COREFUL_LOG_LEVEL_DEBUG 0
+#define COREFUL_LOG_LEVEL_INFO 1
+#define COREFUL_LOG_LEVEL_WARN 2
+#define COREFUL_LOG_LEVEL_ERROR 3
+
+#ifndef COREFUL_LOG_LEVEL
+#ifdef NDEBUG
+#define COREFUL_LOG_LEVEL COREFUL_LOG_LEVEL_INFO
+#else
+#define COREFUL_LOG_LEVEL COREFUL_LOG_LEVEL_DEBUG
+#endif
+#endif
 
 namespace Coreful::Logger {
 
@@ -26,6 +47,20 @@ namespace Coreful::Logger {
         return "[]: ";
     }
 
+    constexpr int severity(const LogType logType) {
+        switch (logType) {
+            case LogType::Debug: return COREFUL_LOG_LEVEL_DEBUG;
+            case LogType::Info: return COREFUL_LOG_LEVEL_INFO;
+            case LogType::Warn: return COREFUL_LOG_LEVEL_WARN;
+            case LogType::Error: return COREFUL_LOG_LEVEL_ERROR;
+        }
+        return COREFUL_LOG_LEVEL_ERROR;
+    }
+
+    constexpr bool isEnabled(const LogType logType) {
+        return severity(logType) >= COREFUL_LOG_LEVEL;
+    }
+
     /*
     inline WORD logColor(const LogType logType) {
         switch (logType) {
@@ -38,85 +73,121 @@ namespace Coreful::Logger {
     }
     */
 
-    inline void init() {
-        std::ofstream logFile("log.txt", std::ios::trunc);
-        logFile.close();
-    }
+    //what happens when the ring is full
+    enum class OverflowPolicy {
+        Drop,//the message is discarded and counted, callers never wait
+        Block//callers wait for the writer thread to make room
+    };
 
-    inline std::ofstream& getLogFile() {
-        static std::ofstream logFile("log.txt", std::ios::app);
-        return logFile;
-    }
+    constexpr size_t SLOT_SIZE = 512;//one ring slot, header included
+    constexpr size_t MESSAGE_SIZE = SLOT_SIZE - 16;//longer messages are truncated
+    constexpr size_t RING_CAPACITY = 1024;//slots, must be a power of two
 
-    inline void outputToFile(const LogType type, const std::string& str) {
-        auto& file = getLogFile();
-        file << logTypeToString(type) << str << std::endl;
-        file.flush();
-    }
+    //starts the writer thread and truncates log.txt, logging before init() starts it implicitly
+    void init();
+
+    //drains every queued message and joins the writer thread, later messages are written synchronously
+    void shutdown();
+
+    void setOverflowPolicy(OverflowPolicy policy);
+
+    //copies message into the ring, the writer thread batches it to the console and log.txt
+    void enqueue(LogType type, std::string_view message);
+
+    //formats into a fixed stack buffer, so logging never allocates
+    class MessageBuffer final : public std::streambuf {
+
+    public:
+
+        MessageBuffer() {setp(m_data, m_data + sizeof(m_data));}
+
+        [[nodiscard]] std::string_view view() const {return {pbase(), static_cast<size_t>(pptr() - pbase())};}
+
+    protected:
+
+        int_type overflow(const int_type ch) override {return traits_type::not_eof(ch);}//full, drop the rest
+
+    private:
+
+        char m_data[MESSAGE_SIZE];
+
+    };
 
     template <Streamable... Args>
     void log(const LogType type = LogType::Info, Args&&... args) {
-        std::stringstream stream;
+        if (!isEnabled(type)) return;
+
+        MessageBuffer buffer;
+        std::ostream stream(&buffer);
         (stream << ... << std::forward<Args>(args));
-        // ReSharper disable once CppLocalVariableMayBeConst
-        /*
-        HANDLE consoleHandle = GetStdHandle(STD_OUTPUT_HANDLE);
-        SetConsoleTextAttribute(consoleHandle, logColor(type));
-        */
-        std::cout << logTypeToString(type) << stream.str() << std::endl;
-
-        outputToFile(type, stream.str());
+
+        enqueue(type, buffer.view());
     }
 
+    //the level is checked at compile time, but arguments are still evaluated at the call site,
+    //the LOG_* macros are the only way to make a disabled message cost nothing
     template <Streamable... Args>
-    void debug(Args&&... args){log(LogType::Debug, std::forward<Args>(args)...);}
+    void debug(Args&&... args){if constexpr (isEnabled(LogType::Debug)) log(LogType::Debug, std::forward<Args>(args)...);}
 
     template <Streamable... Args>
-    void error(Args&&... args){log(LogType::Error, std::forward<Args>(args)...);}
+    void error(Args&&... args){if constexpr (isEnabled(LogType::Error)) log(LogType::Error, std::forward<Args>(args)...);}
 
     template <Streamable... Args>
-    void warn(Args&&... args){log(LogType::Warn, std::forward<Args>(args)...);}
+    void warn(Args&&... args){if constexpr (isEnabled(LogType::Warn)) log(LogType::Warn, std::forward<Args>(args)...);}
 
     template <Streamable... Args>
-    void info(Args&&... args){log(LogType::Info, std::forward<Args>(args)...);}
-
-    /*
+    void info(Args&&... args){if constexpr (isEnabled(LogType::Info)) log(LogType::Info, std::forward<Args>(args)...);}
 
+    //std::format syntax, checked at compile time and formatted straight into a stack buffer
     template <typename... Args>
-    void logf(const LogType type, const std::string_view fmt, Args&&... args) {
-        // ReSharper disable once CppLocalVariableMayBeConst
-        /*
-        HANDLE consoleHandle = GetStdHandle(STD_OUTPUT_HANDLE);
-        SetConsoleTextAttribute(consoleHandle, logColor(type));
-
-        std::cout << logTypeToString(type) << std::vformat(fmt, std::make_format_args(args...)) << std::endl;
+    void logf(const LogType type, std::format_string<Args...> fmt, Args&&... args) {
+        if (!isEnabled(type)) return;
 
-        outputToFile(type, std::vformat(fmt, std::make_format_args(args...)));
+        char buffer[MESSAGE_SIZE];
+        const auto result = std::format_to_n(buffer, MESSAGE_SIZE, fmt, std::forward<Args>(args)...);
+        enqueue(type, {buffer, static_cast<size_t>(result.out - buffer)});
     }
 
+    //same as debug() and co., arguments are evaluated even below the level
     template <typename... Args>
-    void debugf(std::string_view fmt, Args&&... args) {
-        logf(LogType::Debug, fmt, std::forward<Args>(args)...);
+    void debugf(std::format_string<Args...> fmt, Args&&... args) {
+        if constexpr (isEnabled(LogType::Debug)) logf(LogType::Debug, fmt, std::forward<Args>(args)...);
     }
 
     template <typename... Args>
-    void errorf(std::string_view fmt, Args&&... args) {
-        logf(LogType::Error, fmt, std::forward<Args>(args)...);
+    void errorf(std::format_string<Args...> fmt, Args&&... args) {
+        if constexpr (isEnabled(LogType::Error)) logf(LogType::Error, fmt, std::forward<Args>(args)...);
     }
 
     template <typename... Args>
-    void warnf(std::string_view fmt, Args&&... args) {
-        logf(LogType::Warn, fmt, std::forward<Args>(args)...);
+    void warnf(std::format_string<Args...> fmt, Args&&... args) {
+        if constexpr (isEnabled(LogType::Warn)) logf(LogType::Warn, fmt, std::forward<Args>(args)...);
     }
 
     template <typename... Args>
-    void infof(std::string_view fmt, Args&&... args) {
-        logf(LogType::Info, fmt, std::forward<Args>(args)...);
+    void infof(std::format_string<Args...> fmt, Args&&... args) {
+        if constexpr (isEnabled(LogType::Info)) logf(LogType::Info, fmt, std::forward<Args>(args)...);
     }
 
-    */
-
 }
 
-
-
+//the discarded branch is still type checked but never runs, so no argument is evaluated below the level
+#define COREFUL_LOG_AT(type, call, ...) \
+    do { if constexpr (::Coreful::Logger::isEnabled(type)) ::Coreful::Logger::call(type, __VA_ARGS__); } while (0)
+
+#define LOG_DEBUG(...) COREFUL_LOG_AT(::Coreful::Logger::LogType::Debug, log, __VA_ARGS__)
+#define LOG_INFO(...) COREFUL_LOG_AT(::Coreful::Logger::LogType::Info, log, __VA_ARGS__)
+#define LOG_WARN(...) COREFUL_LOG_AT(::Coreful::Logger::LogType::Warn, log, __VA_ARGS__)
+#define LOG_ERROR(...) COREFUL_LOG_AT(::Coreful::Logger::LogType::Error, log, __VA_ARGS__)
+
+#ifdef COREFUL_BINARY_LOG
+#include "BinaryLog.h"
+#define COREFUL_LOGF_AT(type, ...) COREFUL_BINARY_LOG_AT(type, __VA_ARGS__)
+#else
+#define COREFUL_LOGF_AT(type, ...) COREFUL_LOG_AT(type, logf, __VA_ARGS__)
+#endif
+
+#define LOG_DEBUGF(...) COREFUL_LOGF_AT(::Coreful::Logger::LogType::Debug, __VA_ARGS__)
+#define LOG_INFOF(...) COREFUL_LOGF_AT(::Coreful::Logger::LogType::Info, __VA_ARGS__)
+#define LOG_WARNF(...) COREFUL_LOGF_AT(::Coreful::Logger::LogType::Warn, __VA_ARGS__)
+#define LOG_ERRORF(...) COREFUL_LOGF_AT(::Coreful::Logger::LogType::Error, __VA_ARGS__)
@@ -0,0 +1,159 @@
+
+#include "Profiler.h"
+
+#ifdef COREFUL_PROFILING
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Logger.h"
+
+namespace Coreful::Profiler {
+
+    namespace {
+
+        struct Zone {
+            const char* name;
+            uint64_t beginNs;
+            uint64_t endNs;
+        };
+
+        constexpr size_t CHUNK_SIZE = 4096;
+        constexpr size_t MAX_CHUNKS = 256;//about a million zones per thread
+
+        //written only by its own thread, read by the exporter, the count is published after the zone
+        struct ThreadBuffer {
+            std::array<std::atomic<Zone*>, MAX_CHUNKS> chunks{};
+            std::atomic<size_t> count{0};
+            std::atomic<const char*> name{nullptr};
+            uint32_t threadId = 0;
+            std::atomic<size_t> dropped{0};
+
+            ~ThreadBuffer() {
+                for (auto& chunk : chunks) delete[] chunk.load(std::memory_order_relaxed);
+            }
+        };
+
+        struct Registry {
+            std::mutex mutex;//only taken when a thread records for the first time and on export
+            std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+        };
+
+        Registry& getRegistry() {
+            static Registry registry;
+            return registry;
+        }
+
+        //owned by the registry so zones of finished threads survive until export
+        ThreadBuffer& getThreadBuffer() {
+            thread_local ThreadBuffer* buffer = nullptr;
+            if (buffer) return *buffer;
+
+            Registry& registry = getRegistry();
+            std::lock_guard lock(registry.mutex);
+
+            registry.buffers.push_back(std::make_unique<ThreadBuffer>());
+            buffer = registry.buffers.back().get();
+            buffer->threadId = static_cast<uint32_t>(registry.buffers.size());
+            return *buffer;
+        }
+
+        void writeEscaped(std::ofstream& file, const char* text) {
+            for (const char* c = text; *c; c++) {
+                if (*c == '"' || *c == '\\') file << '\\';
+                file << *c;
+            }
+        }
+    }
+
+    void record(const char* name, const uint64_t beginNs, const uint64_t endNs) {
+        ThreadBuffer& buffer = getThreadBuffer();
+
+        const size_t index = buffer.count.load(std::memory_order_relaxed);
+        const size_t chunkIndex = index / CHUNK_SIZE;
+        if (chunkIndex == MAX_CHUNKS) {
+            buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        Zone* chunk = buffer.chunks[chunkIndex].load(std::memory_order_relaxed);
+        if (!chunk) {
+            chunk = new Zone[CHUNK_SIZE];
+            buffer.chunks[chunkIndex].store(chunk, std::memory_order_release);
+        }
+
+        chunk[index % CHUNK_SIZE] = {name, beginNs, endNs};
+        buffer.count.store(index + 1, std::memory_order_release);
+    }
+
+    void setThreadName(const char* name) {
+        getThreadBuffer().name.store(name, std::memory_order_release);
+    }
+
+    bool writeChromeTrace(const std::string& path) {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file.is_open()) {
+            log(Logger::LogType::Error, "Failed to open trace file ", path);
+            return false;
+        }
+
+        Registry& registry = getRegistry();
+        std::lock_guard lock(registry.mutex);
+
+        //only zones published before the count is read, the owning threads may keep recording
+        std::vector<size_t> counts;
+        uint64_t startNs = UINT64_MAX;
+        for (const auto& buffer : registry.buffers) {
+            counts.push_back(buffer->count.load(std::memory_order_acquire));
+            for (size_t i = 0; i < counts.back(); i++) {
+                startNs = std::min(startNs, buffer->chunks[i / CHUNK_SIZE].load(std::memory_order_acquire)[i % CHUNK_SIZE].beginNs);
+            }
+        }
+
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+
+        for (size_t b = 0; b < registry.buffers.size(); b++) {
+            const auto& buffer = registry.buffers[b];
+
+            if (const char* name = buffer->name.load(std::memory_order_acquire)) {
+                file << (first ? "" : ",\n") << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << buffer->threadId
+                     << R"(,"args":{"name":")";
+                writeEscaped(file, name);
+                file << "\"}}";
+                first = false;
+            }
+
+            for (size_t i = 0; i < counts[b]; i++) {
+                const Zone& zone = buffer->chunks[i / CHUNK_SIZE].load(std::memory_order_acquire)[i % CHUNK_SIZE];
+
+                //complete events, microseconds since the first recorded zone
+                file << (first ? "" : ",\n") << R"({"name":")";
+                writeEscaped(file, zone.name);
+                file << R"(","ph":"X","pid":1,"tid":)" << buffer->threadId
+                     << ",\"ts\":" << static_cast<double>(zone.beginNs - startNs) / 1000.0
+                     << ",\"dur\":" << static_cast<double>(zone.endNs - zone.beginNs) / 1000.0 << "}";
+                first = false;
+            }
+
+            if (const size_t dropped = buffer->dropped.load(std::memory_order_relaxed)) {
+                log(Logger::LogType::Warn, "Profiler thread ", buffer->threadId, " dropped ", dropped, " zones");
+            }
+        }
+
+        file << "\n]}\n";
+
+        log(Logger::LogType::Info, "Trace written to ", path);
+        return static_cast<bool>(file);
+    }
+
+}
+
+#endif
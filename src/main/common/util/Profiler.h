@@ -0,0 +1,59 @@
+#pragma once
+
+//PROFILE_SCOPE("name") times the enclosing scope on the calling thread.
+//Without COREFUL_PROFILING every macro expands to nothing.
+
+#ifdef COREFUL_PROFILING
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace Coreful::Profiler {
+
+    inline uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    //appends a finished zone to the calling thread's buffer, name has to be a string literal
+    void record(const char* name, uint64_t beginNs, uint64_t endNs);
+
+    //shown instead of the numeric thread id in the trace viewer
+    void setThreadName(const char* name);
+
+    //chrome://tracing / Perfetto json of everything recorded so far
+    bool writeChromeTrace(const std::string& path);
+
+    class ScopedZone {
+
+    public:
+
+        explicit ScopedZone(const char* name) : m_name(name), m_begin(now()) {}
+        ~ScopedZone() {record(m_name, m_begin, now());}
+
+        ScopedZone(const ScopedZone&) = delete;
+        ScopedZone& operator=(const ScopedZone&) = delete;
+
+    private:
+
+        const char* m_name;
+        uint64_t m_begin;
+
+    };
+}
+
+#define COREFUL_PROFILE_CONCAT_INNER(a, b) a##b
+#define COREFUL_PROFILE_CONCAT(a, b) COREFUL_PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_SCOPE(name) const ::Coreful::Profiler::ScopedZone COREFUL_PROFILE_CONCAT(profileZone_, __LINE__)(name)
+#define PROFILE_THREAD_NAME(name) ::Coreful::Profiler::setThreadName(name)
+#define PROFILE_WRITE_TRACE(path) ::Coreful::Profiler::writeChromeTrace(path)
+
+#else
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#define PROFILE_WRITE_TRACE(path) ((void)0)
+
+#endif
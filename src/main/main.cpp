@@ -1,21 +1,46 @@
+#include <string_view>
 
 #include "core/Application.h"
 #include "util/Logger.h"
+#include "util/Profiler.h"
 
 
-int main() {
+int main(const int argc, char* argv[]) {
 
     Coreful::Logger::init();
 
-    Coreful::Application CorefulApp;
+    //--headless renders a single frame without a window or display server and writes it to coreful_headless.ppm
+    const bool headless = argc > 1 && std::string_view(argv[1]) == "--headless";
 
-    CorefulApp.createWindow(Coreful::math::Vector2u(1080, 720), "CorefulAppDemo");
+    Coreful::Application CorefulApp;
 
     CorefulApp.createRenderer(Coreful::RendererType::VULKAN);//TODO: Add support for pluggable renderer backends selectable at runtime
 
-    CorefulApp.initializeRenderer();
+    if (headless) {
+
+        CorefulApp.initializeHeadlessRenderer(Coreful::math::Vector2u(1080, 720));
+
+        CorefulApp.runHeadless("coreful_headless.ppm");
+
+    }else {
+
+        CorefulApp.createWindow(Coreful::math::Vector2u(1080, 720), "CorefulAppDemo");
+
+        CorefulApp.initializeRenderer();
+
+        CorefulApp.createUI();
+
+        CorefulApp.setThreadingMode(Coreful::ThreadingMode::RenderThread);
+
+        CorefulApp.setDamageTracking(true);
+
+        CorefulApp.run();
+
+    }
+
+    PROFILE_WRITE_TRACE("coreful_trace.json");
 
-    CorefulApp.run();
+    Coreful::Logger::shutdown();
 
     return 0;
 }
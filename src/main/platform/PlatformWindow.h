@@ -1,5 +1,8 @@
 #pragma once
 
+#include <chrono>
+
+#include "core/EventDispatcher.h"
 #include "math/Uint32.h"
 
 namespace Coreful {
@@ -7,8 +10,15 @@ namespace Coreful {
 
         virtual ~PlatformWindow() = default;
 
+        constexpr static auto WAIT_FOREVER = std::chrono::nanoseconds::max();
+
         virtual void processMessages() = 0;
 
+        //blocks until a message arrives, wake() is called or timeout passes, then processes what is there
+        virtual void waitEvents(std::chrono::nanoseconds timeout) = 0;
+        //any thread, returns a blocked or the next waitEvents() early
+        virtual void wake() = 0;
+
         [[nodiscard]] virtual bool isRunning() const = 0;
 
         [[nodiscard]] virtual void* getNativeHandle() const = 0;
@@ -16,6 +26,10 @@ namespace Coreful {
 
         [[nodiscard]] virtual math::Uint32 getWidth() const = 0;
         [[nodiscard]] virtual math::Uint32 getHeight() const = 0;
+        [[nodiscard]] virtual bool isVisible() const = 0;//false while minimized or without area, nothing is worth drawing
+
+        //filled by processMessages(), may be drained from another thread
+        [[nodiscard]] virtual EventDispatcher& getEventDispatcher() = 0;
     };
 }
 
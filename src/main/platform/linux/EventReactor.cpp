@@ -0,0 +1,83 @@
+
+#include "EventReactor.h"
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace Coreful::linux {
+
+    EventReactor::EventReactor(const int connectionFd) {
+        m_epoll = epoll_create1(EPOLL_CLOEXEC);
+        m_timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        if (m_epoll < 0 || m_timer < 0 || m_wake < 0) {
+            cleanup();
+            throw std::runtime_error("Failed to create event reactor");
+        }
+
+        for (const int fd : {connectionFd, m_timer, m_wake}) {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+                cleanup();
+                throw std::runtime_error("Failed to watch event reactor source");
+            }
+        }
+    }
+
+    EventReactor::~EventReactor() {
+        cleanup();
+    }
+
+    void EventReactor::wait(const std::chrono::nanoseconds timeout) {
+        if (timeout <= std::chrono::nanoseconds::zero()) return;
+
+        //a timerfd instead of the epoll timeout, which only has millisecond resolution
+        const bool forever = timeout == std::chrono::nanoseconds::max();
+        if (!forever) {
+            itimerspec deadline{};
+            deadline.it_value.tv_sec = static_cast<time_t>(timeout.count() / 1'000'000'000);
+            deadline.it_value.tv_nsec = static_cast<long>(timeout.count() % 1'000'000'000);
+            timerfd_settime(m_timer, 0, &deadline, nullptr);
+        }
+
+        std::array<epoll_event, 3> events{};
+        const int count = epoll_wait(m_epoll, events.data(), static_cast<int>(events.size()), -1);
+
+        //EINTR just ends the wait early, the caller loops anyway
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.fd == m_timer || events[i].data.fd == m_wake) {
+                uint64_t value;
+                (void)read(events[i].data.fd, &value, sizeof(value));//drained, both are level triggered
+            }
+        }
+
+        if (!forever) {
+            constexpr itimerspec disarm{};
+            timerfd_settime(m_timer, 0, &disarm, nullptr);
+        }
+    }
+
+    void EventReactor::wake() const {
+        constexpr uint64_t one = 1;
+        (void)write(m_wake, &one, sizeof(one));
+    }
+
+    void EventReactor::cleanup() {
+        for (int* fd : {&m_wake, &m_timer, &m_epoll}) {
+            if (*fd >= 0) {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+    }
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <chrono>
+
+namespace Coreful::linux {
+
+    //one epoll over the x11 connection, a timerfd for the wait deadline and an eventfd other threads wake it with
+    class EventReactor {
+
+    public:
+        explicit EventReactor(int connectionFd);
+        ~EventReactor();
+
+        EventReactor(const EventReactor&) = delete;
+        EventReactor& operator=(const EventReactor&) = delete;
+
+        //blocks until the connection is readable, wake() is called or timeout passes, nanoseconds::max() waits forever
+        void wait(std::chrono::nanoseconds timeout);
+
+        //any thread
+        void wake() const;
+
+    private:
+
+        int m_epoll = -1;
+        int m_timer = -1;
+        int m_wake = -1;
+
+        void cleanup();
+
+    };
+
+}
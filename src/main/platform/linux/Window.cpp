@@ -5,11 +5,16 @@ namespace Coreful::linux {
 
     Window::Window(const std::string& title, const math::Vector2u& windowSize) : m_width(windowSize.x), m_height(windowSize.y) {
 
+        //the render thread presents through this display while the main thread reads its events
+        XInitThreads();
+
         m_display = XOpenDisplay(nullptr);
         if (!m_display) {
             throw std::runtime_error("Failed to open X11 display");
         }
 
+        m_reactor = std::make_unique<EventReactor>(ConnectionNumber(m_display));
+
         const int screen = DefaultScreen(m_display);
 
         m_window = XCreateSimpleWindow(
@@ -61,15 +66,37 @@ namespace Coreful::linux {
                 case ClientMessage:
                     if (static_cast<Atom>(event.xclient.data.l[0]) == m_wmDeleteMessage) {
                         m_isRunning = false;
+                        m_eventDispatcher.pushEvent(Event(EventType::WindowClosed));
                     }
                     break;
 
                 case DestroyNotify:
                     m_isRunning = false;
                     break;
+                case Expose:
+                    //only the last of a series, the whole window is redrawn anyway
+                    if (event.xexpose.count == 0) m_eventDispatcher.pushEvent(Event(EventType::WindowExposed));
+                    break;
+                case MapNotify:
+                    m_isMapped = true;
+                    break;
+                case UnmapNotify:
+                    m_isMapped = false;
+                    break;
                 case ConfigureNotify:
-                    m_width = event.xconfigure.width;
-                    m_height = event.xconfigure.height;
+                    //also sent for moves, only a size change is a resize
+                    if (static_cast<uint32_t>(event.xconfigure.width) != m_width.raw() ||
+                        static_cast<uint32_t>(event.xconfigure.height) != m_height.raw()) {
+                        m_width = event.xconfigure.width;
+                        m_height = event.xconfigure.height;
+                        m_eventDispatcher.pushEvent(Event(EventType::WindowResized, event.xconfigure.width, event.xconfigure.height, 0, 0));
+                    }
+                    break;
+                case ButtonPress:
+                    m_eventDispatcher.pushEvent(Event(EventType::MouseButtonPressed, 0, 0, event.xbutton.x, event.xbutton.y));
+                    break;
+                case MotionNotify:
+                    m_eventDispatcher.pushEvent(Event(EventType::MouseMoved, 0, 0, event.xmotion.x, event.xmotion.y));
                     break;
                 default:
                     break;
@@ -77,8 +104,19 @@ namespace Coreful::linux {
         }
     }
 
+    void Window::waitEvents(const std::chrono::nanoseconds timeout) {
+        //requests sitting in xlib's buffer could be what the server's answer depends on
+        XFlush(m_display);
+
+        //events xlib already read off the socket won't make it readable again
+        if (XEventsQueued(m_display, QueuedAlready) == 0) m_reactor->wait(timeout);
 
+        processMessages();
+    }
 
+    void Window::wake() {
+        m_reactor->wake();
+    }
 
     void Window::cleanup() {
         if (m_window) {
@@ -86,6 +124,8 @@ namespace Coreful::linux {
             m_window = 0;
         }
 
+        m_reactor.reset();//watches the display's connection
+
         if (m_display) {
             XCloseDisplay(m_display);
             m_display = nullptr;
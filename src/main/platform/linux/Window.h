@@ -1,7 +1,9 @@
 #pragma once
 
+#include <memory>
 #include <X11/Xlib.h>
 
+#include "EventReactor.h"
 #include "math/Vector2.h"
 #include "platform/PlatformWindow.h"
 
@@ -14,6 +16,8 @@ namespace Coreful::linux {
         ~Window() override;
 
         void processMessages() override;
+        void waitEvents(std::chrono::nanoseconds timeout) override;
+        void wake() override;
         [[nodiscard]] bool isRunning() const override {
             return m_isRunning;
         }
@@ -31,6 +35,13 @@ namespace Coreful::linux {
         [[nodiscard]] math::Uint32 getHeight() const override {
             return m_height;
         }
+        [[nodiscard]] bool isVisible() const override {
+            return m_isMapped && m_width.raw() != 0 && m_height.raw() != 0;
+        }
+
+        [[nodiscard]] EventDispatcher& getEventDispatcher() override {
+            return m_eventDispatcher;
+        }
 
     private:
 
@@ -40,6 +51,11 @@ namespace Coreful::linux {
 
         math::Uint32 m_width, m_height;
         bool m_isRunning = true;
+        bool m_isMapped = true;//x11 keeps the size of a minimized window and unmaps it instead
+
+        std::unique_ptr<EventReactor> m_reactor;
+
+        EventDispatcher m_eventDispatcher;
 
         void cleanup();
 
@@ -16,7 +16,7 @@ namespace Coreful::linux {
         explicit VulkanSurfaceX11(const PlatformWindow& window) : m_window(window) {}
 
         VkSurfaceKHR create(VkInstance& instance) override {
-            Logger::log(Logger::LogType::Debug, "Creating Vulkan Surface");
+            LOG_DEBUG("Creating Vulkan Surface");
             VkXlibSurfaceCreateInfoKHR info{};
             info.sType = VK_STRUCTURE_TYPE_XLIB_SURFACE_CREATE_INFO_KHR;
             info.pNext = nullptr;
@@ -24,7 +24,7 @@ namespace Coreful::linux {
             info.dpy = static_cast<Display*>(m_window.getInstanceHandle());
             info.window = reinterpret_cast<uintptr_t>(m_window.getNativeHandle());
 
-            Logger::log(Logger::LogType::Debug, "Created Vulkan Surface Info");
+            LOG_DEBUG("Created Vulkan Surface Info");
 
             VkSurfaceKHR surface = VK_NULL_HANDLE;
 
@@ -32,7 +32,7 @@ namespace Coreful::linux {
                 throw std::runtime_error("Failed to create X11 Vulkan Surface");
             }
 
-            Logger::log(Logger::LogType::Debug, "Created Vulkan Surface");
+            LOG_DEBUG("Created Vulkan Surface");
             return surface;
         }
 
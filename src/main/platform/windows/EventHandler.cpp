@@ -2,9 +2,9 @@
 
 #include "EventHandler.h"
 
-#include "core/EventDispatcher.h"
+#include <windowsx.h>
 
-//extern EventDispatcher g_eventDispatcher;
+#include "core/EventDispatcher.h"
 
 namespace Coreful::win32 {
     LRESULT EventHandler::handleMessage(const WMC& ctx) {
@@ -14,6 +14,8 @@ namespace Coreful::win32 {
                 PAINTSTRUCT ps;
                 BeginPaint(ctx.hwnd, &ps);
                 EndPaint(ctx.hwnd, &ps);
+
+                ctx.window->m_eventDispatcher.pushEvent(Event(EventType::WindowExposed));
                 break;
             }
             case WM_SIZE: {
@@ -23,7 +25,7 @@ namespace Coreful::win32 {
                 eCtx.height = HIWORD(ctx.lParam);
                 const Event event(EventType::WindowResized, eCtx);
 
-                //g_eventDispatcher.pushEvent(event);
+                ctx.window->m_eventDispatcher.pushEvent(event);
                 break;
             }
             case WM_LBUTTONDOWN: {
@@ -33,14 +35,23 @@ namespace Coreful::win32 {
                 eCtx.mouseY = HIWORD(ctx.lParam);
                 const Event event(EventType::MouseButtonPressed, eCtx);
 
-                //g_eventDispatcher.pushEvent(event);
+                ctx.window->m_eventDispatcher.pushEvent(event);
+                break;
+            }
+            case WM_MOUSEMOVE: {
+                EventContext eCtx;
+                eCtx.mouseX = GET_X_LPARAM(ctx.lParam);//signed, the cursor can be left of the window while captured
+                eCtx.mouseY = GET_Y_LPARAM(ctx.lParam);
+                const Event event(EventType::MouseMoved, eCtx);
+
+                ctx.window->m_eventDispatcher.pushEvent(event);
                 break;
             }
             case WM_CLOSE: {
                 handleClose(ctx);
                 const Event event(EventType::WindowClosed);
 
-                //g_eventDispatcher.pushEvent(event);
+                ctx.window->m_eventDispatcher.pushEvent(event);
                 break;
             }
             case WM_DESTROY: break;
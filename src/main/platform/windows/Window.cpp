@@ -28,6 +28,9 @@ namespace Coreful::win32 {
 
         if (!m_hwnd) throw std::runtime_error("Failed to create window.");
 
+        m_wakeEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        if (!m_wakeEvent) throw std::runtime_error("Failed to create wake event.");
+
 
         ShowWindow(m_hwnd, SW_SHOW);
         UpdateWindow(m_hwnd);
@@ -47,6 +50,24 @@ namespace Coreful::win32 {
         }
     }
 
+    void Window::waitEvents(const std::chrono::nanoseconds timeout) {
+        DWORD milliseconds = INFINITE;
+        if (timeout != WAIT_FOREVER) {
+            //rounded up, returning a little late beats spinning on a zero timeout
+            const auto rounded = std::chrono::ceil<std::chrono::milliseconds>(timeout).count();
+            milliseconds = rounded <= 0 ? 0 : rounded >= INFINITE ? INFINITE - 1 : static_cast<DWORD>(rounded);
+        }
+
+        //MWMO_INPUTAVAILABLE also returns for input that was seen but left in the queue by an earlier peek
+        MsgWaitForMultipleObjectsEx(1, &m_wakeEvent, milliseconds, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+
+        processMessages();
+    }
+
+    void Window::wake() {
+        SetEvent(m_wakeEvent);
+    }
+
     // ReSharper disable once CppParameterMayBeConst
     LRESULT Window::WndProc(HWND hWnd, const UINT msg, const WPARAM wParam, const LPARAM lParam) {
         auto* instance = reinterpret_cast<Window*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
@@ -71,6 +92,11 @@ namespace Coreful::win32 {
             m_hwnd = nullptr;
         }
 
+        if (m_wakeEvent) {
+            CloseHandle(m_wakeEvent);
+            m_wakeEvent = nullptr;
+        }
+
     }
 
 
@@ -31,7 +31,11 @@ namespace Coreful::win32 {
 
         bool m_isRunning;
 
+        EventDispatcher m_eventDispatcher;
+
         void processMessages() override;
+        void waitEvents(std::chrono::nanoseconds timeout) override;
+        void wake() override;
 
         [[nodiscard]] bool isRunning() const override {return m_isRunning;}
 
@@ -40,6 +44,9 @@ namespace Coreful::win32 {
 
         [[nodiscard]] math::Uint32 getWidth() const override {return m_width;}
         [[nodiscard]] math::Uint32 getHeight() const override {return m_height;}
+        [[nodiscard]] bool isVisible() const override {return m_width.raw() != 0 && m_height.raw() != 0;}//minimizing sizes it to zero
+
+        [[nodiscard]] EventDispatcher& getEventDispatcher() override {return m_eventDispatcher;}
 
     private:
 
@@ -47,6 +54,7 @@ namespace Coreful::win32 {
 
         HWND m_hwnd;
         HINSTANCE m_hinstance;
+        HANDLE m_wakeEvent = nullptr;//set by wake(), auto reset
 
 
         void cleanup();
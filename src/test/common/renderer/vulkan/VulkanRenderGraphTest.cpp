@@ -0,0 +1,232 @@
+#include <cstdio>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "renderer/vulkan/VulkanAllocator.h"
+#include "renderer/vulkan/VulkanGpuProfiler.h"
+#include "renderer/vulkan/VulkanRenderGraph.h"
+#include "util/Logger.h"
+
+//compiles small graphs on a real device and checks culling, transient aliasing and the barriers between aliased images,
+//nothing is submitted, execute() records into a fake vkCmdPipelineBarrier2 instead
+using namespace Coreful::renderer::vulkan;
+
+namespace {
+
+    constexpr int SKIPPED = 77;//ctest's SKIP_RETURN_CODE, there is no vulkan device to test on
+
+    //what execute() did in order, either a pass ran or barriers were recorded in front of whatever comes next
+    struct Recorded {
+        const char* pass = nullptr;
+        std::vector<VkImageMemoryBarrier2> imageBarriers;
+        std::vector<VkMemoryBarrier2> memoryBarriers;
+    };
+
+    std::vector<Recorded> recorded;
+    int failures = 0;
+
+    // ReSharper disable once CppParameterMayBeConst
+    VKAPI_ATTR void VKAPI_CALL recordBarriers(VkCommandBuffer, const VkDependencyInfo* dependencyInfo) {
+        Recorded barriers;
+        barriers.imageBarriers.assign(dependencyInfo->pImageMemoryBarriers,
+            dependencyInfo->pImageMemoryBarriers + dependencyInfo->imageMemoryBarrierCount);
+        barriers.memoryBarriers.assign(dependencyInfo->pMemoryBarriers,
+            dependencyInfo->pMemoryBarriers + dependencyInfo->memoryBarrierCount);
+        recorded.push_back(std::move(barriers));
+    }
+
+    auto recordPass(const char* name) {
+        return [name](VkCommandBuffer) {recorded.push_back({name, {}, {}});};
+    }
+
+    //the barriers recorded right before pass ran, nullptr if there were none
+    const Recorded* barriersBefore(const std::string_view pass) {
+        for (size_t i = 1; i < recorded.size(); i++) {
+            if (recorded[i].pass && recorded[i].pass == pass) return recorded[i - 1].pass ? nullptr : &recorded[i - 1];
+        }
+        return nullptr;
+    }
+
+    void check(const bool condition, const char* what) {
+        if (condition) return;
+        std::fprintf(stderr, "FAILED: %s\n", what);
+        failures++;
+    }
+
+    bool hasTransition(const Recorded* barriers, const VkImage image, const VkImageLayout from, const VkImageLayout to,
+                       const VkImageAspectFlags aspect) {
+        if (!barriers) return false;
+        for (const VkImageMemoryBarrier2& barrier : barriers->imageBarriers) {
+            if (barrier.image == image && barrier.oldLayout == from && barrier.newLayout == to
+                && barrier.subresourceRange.aspectMask == aspect) return true;
+        }
+        return false;
+    }
+
+    //"a" and "c" don't overlap and have to share memory, "b" overlaps both, "unused" only feeds a pass that gets culled
+    void testAliasing(VulkanRenderGraph& graph, VulkanGpuProfiler& profiler) {
+        constexpr TransientImageDesc desc{VK_FORMAT_R8G8B8A8_UNORM, {64, 64}, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT};
+
+        //the same images all alive at once, three slots of the same size to compare against
+        graph.reset();
+        {
+            const RenderGraphResource output = graph.importBuffer("output", VK_NULL_HANDLE, {});
+            graph.exportResource(output, HOST_READ_STATE);
+
+            const RenderGraphPass all = graph.addPass("all", recordPass("all"));
+            for (const char* name : {"a", "b", "c"}) graph.write(all, graph.createImage(name, desc), COLOR_ATTACHMENT_STATE);
+            graph.write(all, output, TRANSFER_DST_STATE);
+        }
+        graph.compile();
+        const VkDeviceSize unaliasedSize = graph.getTransientMemorySize();
+
+        graph.reset();
+        const RenderGraphResource a = graph.createImage("a", desc);
+        const RenderGraphResource b = graph.createImage("b", desc);
+        const RenderGraphResource c = graph.createImage("c", desc);
+        const RenderGraphResource unused = graph.createImage("unused", desc);
+        const RenderGraphResource output = graph.importBuffer("output", VK_NULL_HANDLE, {});
+        graph.exportResource(output, HOST_READ_STATE);
+
+        const RenderGraphPass writeA = graph.addPass("write a", recordPass("write a"));
+        graph.write(writeA, a, COLOR_ATTACHMENT_STATE);
+        const RenderGraphPass aToB = graph.addPass("a to b", recordPass("a to b"));
+        graph.read(aToB, a, SHADER_READ_STATE);
+        graph.write(aToB, b, COLOR_ATTACHMENT_STATE);
+        const RenderGraphPass bToC = graph.addPass("b to c", recordPass("b to c"));
+        graph.read(bToC, b, SHADER_READ_STATE);
+        graph.write(bToC, c, COLOR_ATTACHMENT_STATE);
+        const RenderGraphPass culled = graph.addPass("culled", recordPass("culled"));
+        graph.write(culled, unused, COLOR_ATTACHMENT_STATE);
+        const RenderGraphPass cToOutput = graph.addPass("c to output", recordPass("c to output"));
+        graph.read(cToOutput, c, TRANSFER_SRC_STATE);
+        graph.write(cToOutput, output, TRANSFER_DST_STATE);
+
+        graph.compile();
+
+        check(graph.isCulled(culled), "a pass nothing depends on is culled");
+        check(!graph.isCulled(writeA) && !graph.isCulled(aToB) && !graph.isCulled(bToC) && !graph.isCulled(cToOutput),
+            "passes the export depends on are kept");
+        check(graph.getImage(unused) == VK_NULL_HANDLE, "an image only a culled pass uses gets no memory");
+        check(graph.getImage(a) != VK_NULL_HANDLE && graph.getImage(c) != VK_NULL_HANDLE && graph.getImage(a) != graph.getImage(c),
+            "aliased images are still separate images");
+        check(graph.getTransientMemorySize() * 3 == unaliasedSize * 2, "a and c share one memory slot, b gets its own");
+
+        recorded.clear();
+        graph.execute(VK_NULL_HANDLE, profiler);
+
+        //c reuses a's memory, so it starts from UNDEFINED and waits for whatever touched that memory before
+        check(hasTransition(barriersBefore("b to c"), graph.getImage(c), VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT), "an aliased image is transitioned from UNDEFINED");
+        check(hasTransition(barriersBefore("c to output"), graph.getImage(c), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT), "c is transitioned for the copy");
+
+        const Recorded* beforeCopy = barriersBefore("c to output");
+        check(beforeCopy && beforeCopy->memoryBarriers.empty(), "the copy only needs the image barrier for c");
+
+        const Recorded& last = recorded.back();
+        check(!last.pass && last.memoryBarriers.size() == 1 && last.memoryBarriers[0].dstAccessMask == VK_ACCESS_2_HOST_READ_BIT,
+            "the export ends with a host read barrier");
+    }
+
+    void testDepth(VulkanRenderGraph& graph, VulkanGpuProfiler& profiler, const VkPhysicalDevice physicalDevice) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_D32_SFLOAT, &properties);
+        if (!(properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)) return;
+
+        constexpr ResourceState depthState{VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+        graph.reset();
+        const RenderGraphResource depth = graph.createImage("depth", {VK_FORMAT_D32_SFLOAT, {64, 64}, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT});
+        const RenderGraphResource output = graph.importBuffer("output", VK_NULL_HANDLE, {});
+        graph.exportResource(output, HOST_READ_STATE);
+
+        const RenderGraphPass pass = graph.addPass("depth", recordPass("depth"));
+        graph.write(pass, depth, depthState);
+        graph.write(pass, output, TRANSFER_DST_STATE);
+        graph.compile();
+
+        recorded.clear();
+        graph.execute(VK_NULL_HANDLE, profiler);
+        check(hasTransition(barriersBefore("depth"), graph.getImage(depth), VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_DEPTH_BIT), "a depth image is transitioned with the depth aspect");
+    }
+
+    void testInvalidImage(VulkanRenderGraph& graph) {
+        graph.reset();
+        bool threw = false;
+        try {
+            graph.createImage("no format", {VK_FORMAT_UNDEFINED, {64, 64}, VK_IMAGE_USAGE_SAMPLED_BIT});
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        check(threw, "a transient image without a format is rejected");
+    }
+}
+
+int main() {
+    VkApplicationInfo appInfo{};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = "CorefulRenderGraphTest";
+    appInfo.apiVersion = VK_API_VERSION_1_2;
+
+    VkInstanceCreateInfo instanceInfo{};
+    instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instanceInfo.pApplicationInfo = &appInfo;
+
+    VkInstance instance;
+    if (vkCreateInstance(&instanceInfo, nullptr, &instance) != VK_SUCCESS) return SKIPPED;
+
+    uint32_t deviceCount = 1;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    vkEnumeratePhysicalDevices(instance, &deviceCount, &physicalDevice);
+    if (physicalDevice == VK_NULL_HANDLE) {
+        vkDestroyInstance(instance, nullptr);
+        return SKIPPED;
+    }
+
+    //nothing is ever submitted, any queue will do
+    constexpr float queuePriority = 1.0f;
+    VkDeviceQueueCreateInfo queueInfo{};
+    queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueInfo.queueFamilyIndex = 0;
+    queueInfo.queueCount = 1;
+    queueInfo.pQueuePriorities = &queuePriority;
+
+    VkDeviceCreateInfo deviceInfo{};
+    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.queueCreateInfoCount = 1;
+    deviceInfo.pQueueCreateInfos = &queueInfo;
+
+    VkDevice device;
+    if (vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device) != VK_SUCCESS) {
+        vkDestroyInstance(instance, nullptr);
+        return SKIPPED;
+    }
+
+    {
+        VulkanAllocator allocator;
+        allocator.init(physicalDevice, device);
+        VulkanGpuProfiler profiler;//never initialized, scopes record nothing
+
+        VulkanRenderGraph graph;
+        graph.init(allocator, recordBarriers, [](const std::function<void()>& destroy) {destroy();});//nothing is in flight
+
+        testAliasing(graph, profiler);
+        testDepth(graph, profiler, physicalDevice);
+        testInvalidImage(graph);
+
+        graph.cleanup();
+        allocator.cleanup();
+    }
+
+    vkDestroyDevice(device, nullptr);
+    vkDestroyInstance(instance, nullptr);
+    Coreful::Logger::shutdown();
+
+    if (failures == 0) std::printf("render graph tests passed\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+
+//turns a binary log written with COREFUL_BINARY_LOG back into the text log format
+//usage: CorefulLogDecoder log.bin [log.txt]
+
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "util/BinaryLogFormat.h"
+#include "util/Logger.h"
+
+using namespace Coreful;
+using namespace Coreful::BinaryLog;
+
+namespace {
+
+    struct Site {
+        Logger::LogType type = Logger::LogType::Info;
+        std::vector<ArgType> args;
+        std::string format;
+        std::string file;
+        uint32_t line = 0;
+    };
+
+    using Value = std::variant<int64_t, uint64_t, double, bool, std::string>;
+
+    //every read is bounds checked, a truncated or corrupt file ends decoding instead of crashing
+    class Reader {
+
+    public:
+
+        Reader(const uint8_t* data, const size_t size) : m_data(data), m_end(data + size) {}
+
+        template <typename T>
+        bool read(T& value) {
+            if (static_cast<size_t>(m_end - m_data) < sizeof(T)) return false;
+            m_data = get(m_data, value);
+            return true;
+        }
+
+        bool read(std::string& text, const size_t size) {
+            if (static_cast<size_t>(m_end - m_data) < size) return false;
+            text.assign(reinterpret_cast<const char*>(m_data), size);
+            m_data += size;
+            return true;
+        }
+
+    private:
+
+        const uint8_t* m_data;
+        const uint8_t* m_end;
+
+    };
+
+    bool readSite(Reader& reader, std::unordered_map<uint32_t, Site>& sites) {
+        uint32_t id;
+        uint8_t type, argCount;
+        Site site;
+        if (!reader.read(id) || !reader.read(type) || !reader.read(argCount) || !reader.read(site.line)) return false;
+
+        site.type = static_cast<Logger::LogType>(type);
+        site.args.resize(argCount);
+        for (ArgType& arg : site.args) {
+            if (!reader.read(arg)) return false;
+        }
+
+        uint16_t formatSize, fileSize;
+        if (!reader.read(formatSize) || !reader.read(site.format, formatSize)) return false;
+        if (!reader.read(fileSize) || !reader.read(site.file, fileSize)) return false;
+
+        sites[id] = std::move(site);
+        return true;
+    }
+
+    bool readValue(Reader& reader, const ArgType type, Value& value) {
+        switch (type) {
+            case ArgType::Signed: {int64_t v; if (!reader.read(v)) return false; value = v; return true;}
+            case ArgType::Unsigned: {uint64_t v; if (!reader.read(v)) return false; value = v; return true;}
+            case ArgType::Floating: {double v; if (!reader.read(v)) return false; value = v; return true;}
+            case ArgType::Boolean: {uint8_t v; if (!reader.read(v)) return false; value = v != 0; return true;}
+            case ArgType::String: {
+                uint16_t size;
+                std::string text;
+                if (!reader.read(size) || !reader.read(text, size)) return false;
+                value = std::move(text);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //std::format one placeholder at a time, so the original format specs still apply
+    std::string formatMessage(const std::string& fmt, const std::vector<Value>& values) {
+        std::string out;
+        size_t next = 0;
+
+        for (size_t i = 0; i < fmt.size(); i++) {
+            const char c = fmt[i];
+            if ((c == '{' || c == '}') && i + 1 < fmt.size() && fmt[i + 1] == c) {
+                out += c;
+                i++;
+                continue;
+            }
+            if (c != '{') {
+                out += c;
+                continue;
+            }
+
+            const size_t close = fmt.find('}', i);
+            if (close == std::string::npos || next == values.size()) {
+                out.append(fmt, i, std::string::npos);
+                break;
+            }
+
+            //manual argument indices are dropped, the arguments are already in call order
+            const std::string_view placeholder(fmt.data() + i, close - i + 1);
+            const size_t colon = placeholder.find(':');
+            const std::string spec = colon == std::string_view::npos ? "{}" : "{" + std::string(placeholder.substr(colon));
+
+            std::visit([&](const auto& value) {
+                try {
+                    out += std::vformat(spec, std::make_format_args(value));
+                } catch (const std::format_error&) {
+                    out += std::vformat("{}", std::make_format_args(value));
+                }
+            }, values[next++]);
+            i = close;
+        }
+        return out;
+    }
+}
+
+int main(const int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <log.bin> [output.txt]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream input(argv[1], std::ios::binary);
+    if (!input.is_open()) {
+        std::cerr << "Failed to open " << argv[1] << std::endl;
+        return 1;
+    }
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    FileHeader header{};
+    if (data.size() < sizeof(header)) {
+        std::cerr << "Not a binary log" << std::endl;
+        return 1;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+        std::cerr << "Not a binary log, or a version this decoder doesn't know" << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if (argc > 2) file.open(argv[2], std::ios::trunc);
+    std::ostream& output = file.is_open() ? static_cast<std::ostream&>(file) : std::cout;
+
+    //a process that crashed never wrote `used`, fall back to the first uncommitted record
+    size_t end = data.size();
+    if (header.used) end = std::min(end, sizeof(header) + static_cast<size_t>(header.used));
+
+    std::unordered_map<uint32_t, Site> sites;
+    std::vector<Value> values;
+    size_t offset = sizeof(header);
+    size_t events = 0;
+
+    while (offset + RECORD_HEADER_SIZE <= end) {
+        RecordHeader record;
+        std::memcpy(&record, data.data() + offset, sizeof(record));
+        if (record.kind == static_cast<uint16_t>(RecordKind::End) || record.size < RECORD_HEADER_SIZE || offset + record.size > end) break;
+
+        Reader reader(data.data() + offset + RECORD_HEADER_SIZE, record.size - RECORD_HEADER_SIZE);
+        offset += record.size;
+
+        if (record.kind == static_cast<uint16_t>(RecordKind::Site)) {
+            if (!readSite(reader, sites)) break;
+            continue;
+        }
+        if (record.kind != static_cast<uint16_t>(RecordKind::Event)) continue;//newer record kind, skip it
+
+        uint32_t siteId;
+        uint64_t timestamp;
+        if (!reader.read(siteId) || !reader.read(timestamp)) break;
+
+        const auto site = sites.find(siteId);
+        if (site == sites.end()) {
+            output << "[?] event for unknown site " << siteId << "\n";
+            continue;
+        }
+
+        values.clear();
+        for (const ArgType type : site->second.args) {
+            if (!readValue(reader, type, values.emplace_back())) break;
+        }
+
+        const double milliseconds = static_cast<double>(timestamp - header.startNs) / 1e6;
+        output << std::format("[{:12.6f}] ", milliseconds) << Logger::logTypeToString(site->second.type)
+               << formatMessage(site->second.format, values) << "\n";
+        events++;
+    }
+
+    std::cerr << "Decoded " << events << " events from " << sites.size() << " sites" << std::endl;
+    return 0;
+}